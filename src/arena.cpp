@@ -0,0 +1,78 @@
+#include "arena.h"
+#include "litegraph.h"
+
+#include <new>
+
+#define ARENA_ALIGNMENT 16
+#define ARENA_HEADER 16 //keeps the owner arena, so the objects can be deleted as usual
+
+thread_local LiteGraph::LArena* LiteGraph::LArena::current = NULL;
+
+LiteGraph::LArena::LArena(size_t block_size)
+{
+	this->block_size = block_size;
+	block = -1;
+	offset = 0;
+	used = 0;
+}
+
+LiteGraph::LArena::~LArena()
+{
+	for (unsigned int i = 0; i < blocks.size(); ++i)
+		::operator delete(blocks[i].data);
+}
+
+void* LiteGraph::LArena::alloc(size_t size)
+{
+	size = (size + ARENA_ALIGNMENT - 1) & ~(size_t)(ARENA_ALIGNMENT - 1);
+	while (block == -1 || offset + size > blocks[block].size)
+	{
+		//next block that fits, or a new one
+		block++;
+		offset = 0;
+		if (block == (int)blocks.size())
+		{
+			Block new_block;
+			new_block.size = size > block_size ? size : block_size;
+			new_block.data = (uint8_t*)::operator new(new_block.size);
+			blocks.push_back(new_block);
+		}
+	}
+	void* ptr = blocks[block].data + offset;
+	offset += size;
+	used += size;
+	return ptr;
+}
+
+void LiteGraph::LArena::reset()
+{
+	block = -1;
+	offset = 0;
+	used = 0;
+}
+
+size_t LiteGraph::LArena::getReserved()
+{
+	size_t size = 0;
+	for (unsigned int i = 0; i < blocks.size(); ++i)
+		size += blocks[i].size;
+	return size;
+}
+
+void* LiteGraph::arenaNew(size_t size)
+{
+	LArena* arena = LArena::current;
+	uint8_t* ptr = (uint8_t*)(arena ? arena->alloc(size + ARENA_HEADER) : ::operator new(size + ARENA_HEADER));
+	*(LArena**)ptr = arena;
+	return ptr + ARENA_HEADER;
+}
+
+void LiteGraph::arenaDelete(void* ptr)
+{
+	if (!ptr)
+		return;
+	uint8_t* header = (uint8_t*)ptr - ARENA_HEADER;
+	if (*(LArena**)header == NULL)
+		::operator delete(header);
+	//the memory of an arena is released with reset
+}
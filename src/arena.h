@@ -0,0 +1,44 @@
+#pragma once
+
+#include <vector>
+#include <cstddef>
+#include <cstdint>
+
+namespace LiteGraph {
+
+	//bump allocator for the objects of a graph (nodes, slots, links and data), they are not freed one by one,
+	//LGraph::clear resets the whole arena. The blocks are kept to be reused when the graph is loaded again
+	class LArena {
+	public:
+		static thread_local LArena* current; //where LARENA_ALLOCATED objects are created, NULL for the heap
+
+		LArena(size_t block_size = 1 << 20);
+		~LArena();
+
+		void* alloc(size_t size); //16 bytes aligned
+		void reset();
+		size_t getUsed() { return used; }
+		size_t getReserved();
+
+	private:
+		struct Block {
+			uint8_t* data;
+			size_t size;
+		};
+		std::vector<Block> blocks;
+		size_t block_size;
+		int block;		//current block
+		size_t offset;	//in the current block
+		size_t used;
+	};
+
+	//sets the current arena until the end of the scope
+	class LArenaScope {
+	public:
+		LArenaScope(LArena* arena) { previous = LArena::current; LArena::current = arena; }
+		~LArenaScope() { LArena::current = previous; }
+	private:
+		LArena* previous;
+	};
+
+}
@@ -0,0 +1,206 @@
+#include "batch.h"
+
+#define LANES_ALIGNMENT 8 //in doubles, 64 bytes
+
+static bool isLaneType(LiteGraph::DataType type)
+{
+	return type == LiteGraph::DataType::NUMBER || type == LiteGraph::DataType::BOOL || type == LiteGraph::DataType::ANY;
+}
+
+LiteGraph::LGraphBatch::LGraphBatch(LGraph* graph, int num_lanes)
+{
+	this->graph = graph;
+	this->num_lanes = num_lanes;
+	stride = (num_lanes + LANES_ALIGNMENT - 1) / LANES_ALIGNMENT * LANES_ALIGNMENT;
+	buffer = NULL;
+	storage = NULL;
+}
+
+LiteGraph::LGraphBatch::~LGraphBatch()
+{
+	delete[] buffer;
+}
+
+double* LiteGraph::LGraphBatch::allocLanes(LSlot* slot)
+{
+	double* data = storage + lanes.size() * stride;
+	lanes[slot] = data;
+	return data;
+}
+
+bool LiteGraph::LGraphBatch::build()
+{
+	if (graph->plan_dirty)
+		graph->buildExecutionPlan();
+
+	lane_nodes.clear();
+	lanes.clear();
+	delete[] buffer;
+	buffer = NULL;
+	storage = NULL;
+
+	//classify nodes
+	std::vector<LGraphNode*>& nodes = graph->nodes_in_execution_order;
+	int num_arrays = 0;
+	bool valid = true;
+	for (unsigned int i = 0; i < nodes.size(); ++i)
+	{
+		LGraphNode* node = nodes[i];
+		int num_lane_slots = 0;
+		for (unsigned int j = 0; j < node->inputs.size(); ++j)
+			if (isLaneType(node->inputs[j]->type))
+				num_lane_slots++;
+		for (unsigned int j = 0; j < node->outputs.size(); ++j)
+			if (isLaneType(node->outputs[j]->type))
+				num_lane_slots++;
+
+		LaneNode lane_node;
+		lane_node.node = node;
+		if (num_lane_slots == 0)
+			lane_node.mode = UNIFORM;
+		else if (num_lane_slots == (int)(node->inputs.size() + node->outputs.size()))
+		{
+			lane_node.mode = node->flags & NODE_LANES ? LANES : PER_LANE;
+			num_arrays += num_lane_slots;
+		}
+		else
+		{
+			std::cerr << "node cannot be batched, it mixes scalar and non scalar slots: " << node->id << " " << node->getType() << std::endl;
+			valid = false;
+		}
+		lane_nodes.push_back(lane_node);
+	}
+
+	if (!valid)
+	{
+		lane_nodes.clear();
+		return false;
+	}
+
+	//one extra for the alignment
+	int size = (num_arrays + 1) * stride;
+	buffer = new double[size];
+	memset(buffer, 0, size * sizeof(double));
+	uintptr_t alignment = LANES_ALIGNMENT * sizeof(double);
+	storage = (double*)(((uintptr_t)buffer + alignment - 1) & ~(alignment - 1));
+
+	//outputs first, execution order guarantees origins are allocated before their targets (except feedback links)
+	for (unsigned int i = 0; i < lane_nodes.size(); ++i)
+	{
+		LaneNode& lane_node = lane_nodes[i];
+		if (lane_node.mode == UNIFORM)
+			continue;
+		for (unsigned int j = 0; j < lane_node.node->outputs.size(); ++j)
+			lane_node.outputs.push_back(allocLanes(lane_node.node->outputs[j]));
+	}
+
+	for (unsigned int i = 0; i < lane_nodes.size(); ++i)
+	{
+		LaneNode& lane_node = lane_nodes[i];
+		if (lane_node.mode == UNIFORM)
+			continue;
+		for (unsigned int j = 0; j < lane_node.node->inputs.size(); ++j)
+		{
+			LSlot* slot = lane_node.node->inputs[j];
+			auto it = slot->origin ? lanes.find(slot->origin) : lanes.end();
+			if (it != lanes.end())
+			{
+				lane_node.inputs.push_back(it->second);
+				continue;
+			}
+			double* data = allocLanes(slot);
+			lane_node.inputs.push_back(data);
+			//unconnected, executePerLane copies the values of getInputLanes to the data of the slot
+			if (!slot->origin && lane_node.mode == PER_LANE && !slot->data)
+				slot->data = new LData();
+			//origin folded by the plan, every lane reads its value
+			LData* origin_data = slot->origin_data;
+			if (!origin_data || slot->origin->node->order >= 0)
+				continue;
+			double value = origin_data->type == DataType::NUMBER ? origin_data->number : origin_data->type == DataType::BOOL ? (origin_data->boolean ? 1.0 : 0.0) : 0.0;
+			for (int lane = 0; lane < num_lanes; ++lane)
+				data[lane] = value;
+		}
+	}
+
+	return true;
+}
+
+void LiteGraph::LGraphBatch::executePerLane(LaneNode& lane_node)
+{
+	LGraphNode* node = lane_node.node;
+
+	//unconnected inputs read the value of the lane from the data of the slot while the node runs
+	for (unsigned int i = 0; i < node->inputs.size(); ++i)
+		if (!node->inputs[i]->origin)
+			node->inputs[i]->origin_data = node->inputs[i]->data;
+	for (unsigned int i = 0; i < node->ports.size(); ++i)
+		node->ports[i]->bind();
+
+	for (int lane = 0; lane < num_lanes; ++lane)
+	{
+		for (unsigned int i = 0; i < node->inputs.size(); ++i)
+		{
+			LSlot* slot = node->inputs[i];
+			if (!slot->origin_data)
+				continue;
+			double v = lane_node.inputs[i][lane];
+			if ((slot->origin ? slot->origin->type : slot->type) == DataType::BOOL)
+				slot->origin_data->assign(v != 0);
+			else
+				slot->origin_data->assign(v);
+		}
+
+		node->onExecute();
+
+		for (unsigned int i = 0; i < node->outputs.size(); ++i)
+		{
+			LData* data = node->outputs[i]->data;
+			double v = 0;
+			if (data->type == DataType::NUMBER)
+				v = data->number;
+			else if (data->type == DataType::BOOL)
+				v = data->boolean ? 1 : 0;
+			lane_node.outputs[i][lane] = v;
+		}
+	}
+
+	for (unsigned int i = 0; i < node->inputs.size(); ++i)
+		if (!node->inputs[i]->origin)
+			node->inputs[i]->origin_data = NULL;
+	for (unsigned int i = 0; i < node->ports.size(); ++i)
+		node->ports[i]->bind();
+}
+
+void LiteGraph::LGraphBatch::runStep(float dt)
+{
+	for (unsigned int i = 0; i < lane_nodes.size(); ++i)
+	{
+		LaneNode& lane_node = lane_nodes[i];
+		switch (lane_node.mode)
+		{
+			case UNIFORM: lane_node.node->onExecute(); break;
+			case LANES: lane_node.node->onExecuteLanes(lane_node.inputs.data(), lane_node.outputs.data(), num_lanes); break;
+			case PER_LANE: executePerLane(lane_node); break;
+		}
+	}
+	graph->time += dt;
+}
+
+double* LiteGraph::LGraphBatch::getOutputLanes(LGraphNode* node, int slot)
+{
+	LSlot* output = node->getOutputSlot(slot);
+	auto it = output ? lanes.find(output) : lanes.end();
+	if (it == lanes.end())
+		return NULL;
+	return it->second;
+}
+
+double* LiteGraph::LGraphBatch::getInputLanes(LGraphNode* node, int slot)
+{
+	LSlot* input = node->getInputSlot(slot);
+	auto it = input ? lanes.find(input) : lanes.end();
+	if (it == lanes.end())
+		return NULL;
+	return it->second;
+}
@@ -0,0 +1,45 @@
+#pragma once
+
+#include "litegraph.h"
+
+namespace LiteGraph {
+
+	//executes one graph topology for many instances (lanes) at once
+	//NUMBER, BOOL and ANY slots store one value per lane in contiguous arrays (bools as 0 or 1)
+	//nodes with NODE_LANES process all the lanes in one call, the rest run lane by lane through onExecute
+	//(so they shouldnt keep state between steps), nodes without scalar slots are executed once for all the lanes
+	class LGraphBatch {
+	public:
+		LGraph* graph;	//not owned, its slots data is used as scratch by the nodes executed lane by lane
+		int num_lanes;
+
+		LGraphBatch(LGraph* graph, int num_lanes);
+		~LGraphBatch();
+
+		bool build(); //must be called when the graph topology changes, false if some node cannot be batched
+		void runStep(float dt = 0);
+
+		double* getOutputLanes(LGraphNode* node, int slot);
+		double* getInputLanes(LGraphNode* node, int slot); //only for unconnected inputs, allows to set a different value per instance
+
+	private:
+		enum LaneMode { UNIFORM, LANES, PER_LANE };
+
+		struct LaneNode {
+			LGraphNode* node;
+			LaneMode mode;
+			std::vector<const double*> inputs;
+			std::vector<double*> outputs;
+		};
+
+		std::vector<LaneNode> lane_nodes;
+		std::map<LSlot*, double*> lanes;
+		double* buffer;		//all the lane arrays
+		double* storage;	//buffer aligned
+		int stride;			//num_lanes rounded up so every array is aligned for SIMD
+
+		double* allocLanes(LSlot* slot);
+		void executePerLane(LaneNode& lane_node);
+	};
+
+}
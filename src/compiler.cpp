@@ -0,0 +1,277 @@
+#include "compiler.h"
+
+#include <cmath>
+
+LiteGraph::LCompiler::LCompiler(LGraph* graph, const char* prefix)
+{
+	this->graph = graph;
+	this->prefix = prefix;
+}
+
+//two passes, the first one only collects the variables so feedback links can read outputs declared later
+bool LiteGraph::LCompiler::compile(std::string& source)
+{
+	//the plan is only built like this for the compiler, the graph runs with its own optimizations
+	int optimizations = graph->optimizations;
+	graph->optimizations |= OPTIMIZE_INLINE_SUBGRAPHS; //subgraphs are compiled as part of the graph
+	graph->optimizations &= ~OPTIMIZE_FUSION; //the nodes know better how to compile themselves
+	graph->buildExecutionPlan();
+	graph->optimizations = optimizations;
+	std::vector<LGraphNode*>& nodes = graph->nodes_in_execution_order;
+
+	variables.clear();
+	for (int pass = 0; pass < 2; ++pass)
+	{
+		errors.clear();
+		wires.clear();
+		code.str("");
+		state.str("");
+		init.str("");
+		store.str("");
+		for (unsigned int i = 0; i < nodes.size(); ++i)
+		{
+			LGraphNode* node = nodes[i];
+			code << "\t//" << node->id << " " << node->getType() << "\n";
+			if (!node->onCompile(this))
+				errors.push_back(std::string("node cannot be compiled: ") + std::to_string(node->id) + " " + node->getType());
+		}
+	}
+	graph->invalidateExecutionPlan(); //built again with the original optimizations in the next step
+
+	if (errors.size())
+	{
+		for (unsigned int i = 0; i < errors.size(); ++i)
+			std::cerr << errors[i] << std::endl;
+		return false;
+	}
+
+	std::ostringstream out;
+	out << "//generated by LiteGraph::LCompiler, do not edit\n\n";
+	out << "#include <cmath>\n#include <string>\n#include <sstream>\n#include <iostream>\n\n";
+	out << "static std::string " << prefix << "_toString(double v) { std::ostringstream ss; ss << v; return ss.str(); }\n\n";
+	out << "struct " << prefix << "_state\n{\n\tdouble time;\n" << state.str() << "};\n\n";
+
+	out << "extern \"C\" void* " << prefix << "_create()\n{\n";
+	out << "\t" << prefix << "_state* s = new " << prefix << "_state();\n\ts->time = 0;\n" << init.str() << "\treturn s;\n}\n\n";
+
+	out << "extern \"C\" void " << prefix << "_destroy(void* state)\n{\n\tdelete (" << prefix << "_state*)state;\n}\n\n";
+
+	out << "extern \"C\" void " << prefix << "_step(void* state, double dt)\n{\n";
+	out << "\t" << prefix << "_state* s = (" << prefix << "_state*)state;\n\tconst double time = s->time;\n\n";
+	out << code.str() << "\n";
+	out << store.str();
+	out << "\ts->time += dt;\n}\n\n";
+
+	out << "extern \"C\" int " << prefix << "_wires(void* state, double* out)\n{\n";
+	out << "\t" << prefix << "_state* s = (" << prefix << "_state*)state;\n\tif (out)\n\t{\n";
+	for (unsigned int i = 0; i < wires.size(); ++i)
+		out << "\t\tout[" << i << "] = s->" << variables[wires[i]].name << ";\n";
+	out << "\t}\n\treturn " << wires.size() << ";\n}\n";
+
+	source = out.str();
+	return true;
+}
+
+std::string LiteGraph::LCompiler::declare(LSlot* output, const char* ctype, const std::string& expression)
+{
+	LGraphNode* node = output->node;
+	int index = 0;
+	while (node->outputs[index] != output)
+		++index;
+
+	Variable& variable = variables[output];
+	variable.name = "v" + std::to_string(node->order) + "_" + std::to_string(index);
+	variable.ctype = ctype;
+
+	code << "\tconst " << ctype << " " << variable.name << " = " << expression << ";\n";
+	state << "\t" << ctype << " " << variable.name << ";\n";
+	store << "\ts->" << variable.name << " = " << variable.name << ";\n";
+	if (variable.ctype == "double" || variable.ctype == "bool")
+		wires.push_back(output);
+	return variable.name;
+}
+
+std::string LiteGraph::LCompiler::member(LGraphNode* node, const char* name, const char* ctype, const std::string& value)
+{
+	std::string member_name = "m" + std::to_string(node->order) + "_" + name;
+	state << "\t" << ctype << " " << member_name << ";\n";
+	init << "\ts->" << member_name << " = " << value << ";\n";
+	return "s->" + member_name;
+}
+
+const LiteGraph::LCompiler::Variable* LiteGraph::LCompiler::getOrigin(LGraphNode* node, int slot)
+{
+	const Variable* variable = NULL;
+	originExpression(node, slot, variable);
+	return variable;
+}
+
+std::string LiteGraph::LCompiler::originExpression(LGraphNode* node, int slot, const Variable*& variable)
+{
+	variable = NULL;
+	LSlot* input = node->getInputSlot(slot);
+	if (!input || !input->origin)
+		return "";
+	auto it = variables.find(input->origin);
+	if (it == variables.end() && input->origin->node->order < 0 && input->origin_data)
+		it = addConstant(input->origin, input->origin_data);
+	if (it == variables.end())
+		return "";
+	variable = &it->second;
+	if (input->link && input->link->feedback) //value from the previous step
+		return "s->" + variable->name;
+	return variable->name;
+}
+
+std::string LiteGraph::LCompiler::inputAsNumber(LGraphNode* node, int slot)
+{
+	const Variable* variable;
+	std::string expression = originExpression(node, slot, variable);
+	if (!variable || variable->ctype != "double")
+		return "0.0";
+	return expression;
+}
+
+std::string LiteGraph::LCompiler::inputAsBoolean(LGraphNode* node, int slot)
+{
+	const Variable* variable;
+	std::string expression = originExpression(node, slot, variable);
+	if (!variable || variable->ctype != "bool")
+		return "false";
+	return expression;
+}
+
+std::string LiteGraph::LCompiler::inputAsString(LGraphNode* node, int slot)
+{
+	const Variable* variable;
+	std::string expression = originExpression(node, slot, variable);
+	if (!variable)
+		return "std::string()";
+	if (variable->ctype == "std::string")
+		return expression;
+	if (variable->ctype == "double")
+		return prefix + "_toString(" + expression + ")";
+	return "std::string()";
+}
+
+//outputs folded by the plan are emitted as literals
+std::map<LiteGraph::LSlot*, LiteGraph::LCompiler::Variable>::iterator LiteGraph::LCompiler::addConstant(LSlot* output, LData* data)
+{
+	Variable variable;
+	if (data->type == DataType::NUMBER)
+	{
+		variable.name = number(data->number);
+		variable.ctype = "double";
+	}
+	else if (data->type == DataType::BOOL)
+	{
+		variable.name = data->boolean ? "true" : "false";
+		variable.ctype = "bool";
+	}
+	else if (data->type == DataType::STRING)
+	{
+		variable.name = "std::string(" + quote(data->getString()) + ")";
+		variable.ctype = "std::string";
+	}
+	else
+		return variables.end();
+	return variables.insert(std::make_pair(output, variable)).first;
+}
+
+bool LiteGraph::LCompiler::trigger(LGraphNode* node, int slot, const std::string& event)
+{
+	LSlot* output = node->getOutputSlot(slot);
+	if (!output)
+		return false;
+	bool valid = true;
+	for (unsigned int i = 0; i < output->targets.size(); ++i)
+	{
+		LSlot* target = output->targets[i];
+		if (!target->node->onCompileAction(this, target->link->target_slot, event))
+		{
+			errors.push_back(std::string("node cannot compile actions: ") + std::to_string(target->node->id) + " " + target->node->getType());
+			valid = false;
+		}
+	}
+	return valid;
+}
+
+std::string LiteGraph::LCompiler::number(double v)
+{
+	if (std::isnan(v))
+		return "NAN";
+	if (std::isinf(v))
+		return v > 0 ? "INFINITY" : "-INFINITY";
+	char buffer[32];
+	snprintf(buffer, sizeof buffer, "%.17g", v);
+	std::string result = buffer;
+	if (result.find_first_of(".e") == std::string::npos)
+		result += ".0";
+	return result;
+}
+
+std::string LiteGraph::LCompiler::quote(const std::string& str)
+{
+	std::string result = "\"";
+	for (unsigned int i = 0; i < str.size(); ++i)
+	{
+		char c = str[i];
+		if (c == '"' || c == '\\')
+			result += '\\';
+		if (c == '\n')
+		{
+			result += "\\n";
+			continue;
+		}
+		result += c;
+	}
+	return result + "\"";
+}
+
+bool LiteGraph::verifyCompiledGraph(LGraph* graph, const LCompiledGraph& compiled, int num_steps, float dt, double tolerance)
+{
+	LCompiler compiler(graph);
+	std::string source;
+	if (!compiler.compile(source))
+		return false;
+
+	void* state = compiled.create();
+	int num = compiled.wires(state, NULL);
+	if (num != (int)compiler.wires.size())
+	{
+		std::cerr << "compiled graph doesnt match, wires: " << num << " expected " << compiler.wires.size() << std::endl;
+		compiled.destroy(state);
+		return false;
+	}
+
+	//the wires are read from the slots, so it runs with the same plan than the compiler (fused nodes dont write them)
+	int optimizations = graph->optimizations;
+	graph->optimizations = (optimizations | OPTIMIZE_INLINE_SUBGRAPHS) & ~OPTIMIZE_FUSION;
+	std::vector<double> values(num);
+	bool valid = true;
+	for (int step = 0; step < num_steps && valid; ++step)
+	{
+		graph->runStep(dt);
+		compiled.step(state, dt);
+		compiled.wires(state, values.data());
+		for (int i = 0; i < num; ++i)
+		{
+			LData* data = compiler.wires[i]->data;
+			double v = 0;
+			if (data->type == DataType::NUMBER)
+				v = data->number;
+			else if (data->type == DataType::BOOL)
+				v = data->boolean ? 1 : 0;
+			if (std::fabs(v - values[i]) <= tolerance || (std::isnan(v) && std::isnan(values[i])))
+				continue;
+			LGraphNode* node = compiler.wires[i]->node;
+			std::cerr << "step " << step << ", node " << node->id << " " << node->getType() << " output " << compiler.wires[i]->name << ": " << v << " compiled " << values[i] << std::endl;
+			valid = false;
+		}
+	}
+	graph->optimizations = optimizations;
+	graph->invalidateExecutionPlan();
+
+	compiled.destroy(state);
+	return valid;
+}
@@ -0,0 +1,64 @@
+#pragma once
+
+#include "litegraph.h"
+
+#include <sstream>
+
+namespace LiteGraph {
+
+	//translates a graph to a standalone C++ translation unit where every node is inlined code over typed variables
+	//nodes must implement onCompile (and onCompileAction if they receive events)
+	//the generated unit exports (extern "C"), being PREFIX the name passed to the compiler:
+	//  void* PREFIX_create();
+	//  void PREFIX_destroy(void* state);
+	//  void PREFIX_step(void* state, double dt);
+	//  int PREFIX_wires(void* state, double* out); //values of the NUMBER and BOOL outputs, to compare with the interpreter
+	class LCompiler {
+	public:
+		struct Variable {
+			std::string name;
+			std::string ctype;
+		};
+
+		LGraph* graph;
+		std::string prefix;
+		std::vector<std::string> errors;
+		std::vector<LSlot*> wires;	//scalar outputs in the order they are exported
+
+		LCompiler(LGraph* graph, const char* prefix = "lgraph");
+
+		bool compile(std::string& source);
+
+		//used by the nodes in onCompile
+		std::ostringstream code;	//body of the step function, local "time" holds the graph time
+		std::string declare(LSlot* output, const char* ctype, const std::string& expression); //computes an output, returns the variable
+		std::string member(LGraphNode* node, const char* name, const char* ctype, const std::string& init); //state kept between steps
+		std::string inputAsNumber(LGraphNode* node, int slot);	//expressions with the same conversions than getInputDataAs...
+		std::string inputAsBoolean(LGraphNode* node, int slot);
+		std::string inputAsString(LGraphNode* node, int slot);
+		const Variable* getOrigin(LGraphNode* node, int slot); //NULL if not connected
+		bool trigger(LGraphNode* node, int slot, const std::string& event); //inlines the onCompileAction of the targets
+		static std::string number(double v);
+		static std::string quote(const std::string& str);
+
+	private:
+		std::map<LSlot*, Variable> variables;
+		std::ostringstream state;	//members of the state struct
+		std::ostringstream init;
+		std::ostringstream store;	//outputs saved at the end of the step
+		std::string originExpression(LGraphNode* node, int slot, const Variable*& variable);
+		std::map<LSlot*, Variable>::iterator addConstant(LSlot* output, LData* data);
+	};
+
+	//functions exported by a compiled graph
+	struct LCompiledGraph {
+		void* (*create)();
+		void (*destroy)(void* state);
+		void (*step)(void* state, double dt);
+		int (*wires)(void* state, double* out);
+	};
+
+	//runs the interpreter and the compiled graph side by side, comparing all the wires after every step
+	bool verifyCompiledGraph(LGraph* graph, const LCompiledGraph& compiled, int num_steps, float dt, double tolerance = 1e-9);
+
+}
@@ -0,0 +1,98 @@
+#include "conversion.h"
+#include "compiler.h"
+#include "fusion.h"
+
+bool LiteGraph::LConversionNode::canConvert(DataType from, DataType to)
+{
+	if (from != DataType::NUMBER && from != DataType::BOOL)
+		return false;
+	return to == DataType::NUMBER || to == DataType::BOOL || to == DataType::STRING;
+}
+
+LiteGraph::LConversionNode::LConversionNode(LGraph* graph, DataType from, DataType to)
+{
+	this->graph = graph;
+	this->from = from;
+	this->to = to;
+	flags = NODE_THREAD_SAFE | NODE_PURE;
+	if (to != DataType::STRING)
+		flags |= NODE_LANES | NODE_FUSABLE; //lanes and registers already keep bools as 0 or 1
+	addInput("in", from);
+	addOutput("out", to);
+}
+
+void LiteGraph::LConversionNode::onExecute()
+{
+	//the value written by the origin, its slot type is only what the plan expects
+	LData* data = inputs[0]->getOriginData();
+	double v = 0;
+	if (data && data->type == DataType::NUMBER)
+		v = data->number;
+	else if (data && data->type == DataType::BOOL)
+		v = data->boolean ? 1 : 0;
+	else if (data && data->type == to)
+	{
+		*outputs[0]->data = *data;
+		return;
+	}
+
+	LData* output = outputs[0]->data;
+	switch (to)
+	{
+		case DataType::NUMBER: output->assign(v); break;
+		case DataType::BOOL: output->assign(v != 0); break;
+		case DataType::STRING:
+		{
+			char buffer[32];
+			if (data && data->type == DataType::BOOL)
+				snprintf(buffer, sizeof(buffer), "%s", data->boolean ? "true" : "false");
+			else
+				snprintf(buffer, sizeof(buffer), "%g", v); //same format than getInputDataAsString
+			output->assign(buffer);
+			break;
+		}
+		default: break;
+	}
+}
+
+void LiteGraph::LConversionNode::onExecuteLanes(const double* const* inputs, double* const* outputs, int num_lanes)
+{
+	const double* in = inputs[0];
+	double* out = outputs[0];
+	if (to == DataType::BOOL)
+		for (int i = 0; i < num_lanes; ++i)
+			out[i] = in[i] != 0 ? 1 : 0;
+	else
+		memcpy(out, in, num_lanes * sizeof(double));
+}
+
+bool LiteGraph::LConversionNode::onFuse(LFusedNode* fused)
+{
+	if (to == DataType::STRING)
+		return false;
+	int v = fused->input(this, 0, from);
+	if (to == DataType::BOOL)
+		v = fused->op(FUSED_NEQUAL, v, fused->op(FUSED_CONST));
+	fused->output(this, 0, v);
+	return true;
+}
+
+bool LiteGraph::LConversionNode::onCompile(LCompiler* compiler)
+{
+	const LCompiler::Variable* origin = compiler->getOrigin(this, 0);
+	bool is_bool = origin && origin->ctype == "bool";
+	std::string value = is_bool ? "(" + compiler->inputAsBoolean(this, 0) + " ? 1.0 : 0.0)" : compiler->inputAsNumber(this, 0);
+	switch (to)
+	{
+		case DataType::NUMBER: compiler->declare(outputs[0], "double", value); break;
+		case DataType::BOOL: compiler->declare(outputs[0], "bool", "(" + value + " != 0)"); break;
+		case DataType::STRING:
+			if (is_bool)
+				compiler->declare(outputs[0], "std::string", "std::string(" + compiler->inputAsBoolean(this, 0) + " ? \"true\" : \"false\")");
+			else
+				compiler->declare(outputs[0], "std::string", compiler->inputAsString(this, 0));
+			break;
+		default: return false;
+	}
+	return true;
+}
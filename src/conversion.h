@@ -0,0 +1,25 @@
+#pragma once
+
+#include "litegraph.h"
+
+namespace LiteGraph {
+
+	//inserted by the execution plan between an output and an input of different types (LGraph::resolveSlotTypes)
+	//NUMBER and BOOL convert to each other (0 is false, true is 1) and both to STRING
+	class LConversionNode : public LGraphNode
+	{
+	public:
+		DataType from;
+		DataType to;
+
+		static bool canConvert(DataType from, DataType to);
+
+		LConversionNode(LGraph* graph, DataType from, DataType to);
+		const char* getType() { return "graph/conversion"; }
+		void onExecute();
+		void onExecuteLanes(const double* const* inputs, double* const* outputs, int num_lanes);
+		bool onFuse(LFusedNode* fused);
+		bool onCompile(LCompiler* compiler);
+	};
+
+}
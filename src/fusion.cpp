@@ -0,0 +1,209 @@
+#include "fusion.h"
+
+#include <cmath>
+
+LiteGraph::LFusedNode::LFusedNode(LGraph* graph)
+{
+	this->graph = graph;
+	flags = NODE_THREAD_SAFE | NODE_ALWAYS_RUN | NODE_LANES;
+	num_registers = 0;
+}
+
+bool LiteGraph::LFusedNode::add(LGraphNode* node)
+{
+	if (!node->onFuse(this))
+		return false;
+	member_indices[node] = (int)members.size();
+	members.push_back(node);
+	if (!(node->flags & NODE_THREAD_SAFE))
+		flags &= ~NODE_THREAD_SAFE;
+	return true;
+}
+
+bool LiteGraph::LFusedNode::contains(LGraphNode* node)
+{
+	return member_indices.find(node) != member_indices.end();
+}
+
+int LiteGraph::LFusedNode::input(LGraphNode* node, int slot_index, DataType type)
+{
+	LSlot* slot = node->getInputSlot(slot_index);
+	if (!slot || !slot->origin)
+		return op(FUSED_CONST);
+
+	//computed inside the group
+	auto it = member_output_indices.find(slot->origin);
+	if (it != member_output_indices.end())
+		return member_outputs[it->second]->type == type ? member_registers[it->second] : op(FUSED_CONST);
+
+	std::pair<LSlot*, int> key(slot->origin, (int)type);
+	auto it2 = input_indices.find(key);
+	if (it2 != input_indices.end())
+		return input_registers[it2->second];
+
+	input_indices[key] = (int)inputs.size();
+	LSlot* input = addInput(slot->name.c_str(), type);
+	input->origin = slot->origin;
+	input->origin_data = slot->origin_data; //added to the targets of the origin in finish, if the group is kept
+	input_registers.push_back(num_registers++);
+	return input_registers.back();
+}
+
+int LiteGraph::LFusedNode::op(FusedOpCode code, int a, int b, int c, double x, double y)
+{
+	LFusedOp fused_op;
+	fused_op.code = code;
+	fused_op.out = num_registers++;
+	fused_op.a = a;
+	fused_op.b = b;
+	fused_op.c = c;
+	fused_op.x = x;
+	fused_op.y = y;
+	ops.push_back(fused_op);
+	return fused_op.out;
+}
+
+void LiteGraph::LFusedNode::output(LGraphNode* node, int slot, int reg)
+{
+	member_output_indices[node->outputs[slot]] = (int)member_outputs.size();
+	member_outputs.push_back(node->outputs[slot]);
+	member_registers.push_back(reg);
+}
+
+LiteGraph::LSlot* LiteGraph::LFusedNode::getFusedOutput(int index)
+{
+	if (fused_outputs[index])
+		return fused_outputs[index];
+	LSlot* member_output = member_outputs[index];
+	fused_outputs[index] = addOutput(member_output->name.c_str(), member_output->type);
+	output_registers.push_back(member_registers[index]);
+	return fused_outputs[index];
+}
+
+void LiteGraph::LFusedNode::finish()
+{
+	fused_outputs.assign(member_outputs.size(), NULL);
+	for (unsigned int i = 0; i < member_outputs.size(); ++i)
+	{
+		std::vector<LSlot*>& targets = member_outputs[i]->targets;
+		for (unsigned int j = 0; j < targets.size(); ++j)
+		{
+			if (contains(targets[j]->node))
+				continue;
+			LSlot* output = getFusedOutput(i);
+			targets[j]->origin = output;
+			targets[j]->origin_data = output->data;
+			output->targets.push_back(targets[j]);
+		}
+	}
+
+	//feedback links inside the group read the value of the previous step from our outputs
+	for (unsigned int i = 0; i < inputs.size(); ++i)
+	{
+		auto it = member_output_indices.find(inputs[i]->origin);
+		if (it == member_output_indices.end())
+			continue;
+		inputs[i]->origin = getFusedOutput(it->second);
+		inputs[i]->origin_data = inputs[i]->origin->data;
+	}
+	for (unsigned int i = 0; i < inputs.size(); ++i)
+		inputs[i]->origin->targets.push_back(inputs[i]);
+	registers.resize(num_registers);
+}
+
+void LiteGraph::LFusedNode::onExecute()
+{
+	double* r = &registers[0];
+	for (unsigned int i = 0; i < inputs.size(); ++i)
+	{
+		LData* data = inputs[i]->origin_data;
+		double v = 0;
+		if (data && data->type == inputs[i]->type)
+			v = data->type == DataType::BOOL ? (data->boolean ? 1 : 0) : data->number;
+		r[input_registers[i]] = v;
+	}
+
+	for (unsigned int i = 0; i < ops.size(); ++i)
+	{
+		const LFusedOp& o = ops[i];
+		double& out = r[o.out];
+		switch (o.code)
+		{
+			case FUSED_CONST: out = o.x; break;
+			case FUSED_TIME: out = graph->time * o.x; break;
+			case FUSED_EQUAL: out = r[o.a] == r[o.b]; break;
+			case FUSED_NEQUAL: out = r[o.a] != r[o.b]; break;
+			case FUSED_GREATER: out = r[o.a] > r[o.b]; break;
+			case FUSED_GEQUAL: out = r[o.a] >= r[o.b]; break;
+			case FUSED_LESS: out = r[o.a] < r[o.b]; break;
+			case FUSED_LEQUAL: out = r[o.a] <= r[o.b]; break;
+			case FUSED_AND: out = r[o.a] != 0 && r[o.b] != 0; break;
+			case FUSED_OR: out = r[o.a] != 0 || r[o.b] != 0; break;
+			case FUSED_NOT: out = r[o.a] == 0; break;
+			case FUSED_SELECT: out = r[o.a] != 0 ? r[o.b] : r[o.c]; break;
+			case FUSED_SIN: out = sin(r[o.a]) * o.x + o.y; break;
+			case FUSED_COS: out = cos(r[o.a]) * o.x + o.y; break;
+			case FUSED_TAN: out = tan(r[o.a]) * o.x + o.y; break;
+			case FUSED_ASIN: out = asin(r[o.a]) * o.x + o.y; break;
+			case FUSED_ACOS: out = acos(r[o.a]) * o.x + o.y; break;
+			case FUSED_ATAN: out = atan(r[o.a]) * o.x + o.y; break;
+		}
+	}
+
+	for (unsigned int i = 0; i < outputs.size(); ++i)
+	{
+		double v = r[output_registers[i]];
+		if (outputs[i]->type == DataType::BOOL)
+			outputs[i]->data->assign(v != 0);
+		else
+			outputs[i]->data->assign(v);
+	}
+}
+
+//same as onExecute but every op is a loop over the lanes
+#define FUSED_LANES(EXPR) for (int i = 0; i < num_lanes; ++i) { out[i] = (EXPR); }
+
+void LiteGraph::LFusedNode::onExecuteLanes(const double* const* inputs, double* const* outputs, int num_lanes)
+{
+	if (lanes.size() < (size_t)(num_registers * num_lanes))
+		lanes.resize(num_registers * num_lanes);
+	double* r = &lanes[0];
+	for (unsigned int i = 0; i < input_registers.size(); ++i)
+		memcpy(r + input_registers[i] * num_lanes, inputs[i], num_lanes * sizeof(double));
+
+	double time = graph->time;
+	for (unsigned int j = 0; j < ops.size(); ++j)
+	{
+		const LFusedOp& o = ops[j];
+		double* out = r + o.out * num_lanes;
+		const double* a = o.a >= 0 ? r + o.a * num_lanes : NULL;
+		const double* b = o.b >= 0 ? r + o.b * num_lanes : NULL;
+		const double* c = o.c >= 0 ? r + o.c * num_lanes : NULL;
+		double x = o.x;
+		double y = o.y;
+		switch (o.code)
+		{
+			case FUSED_CONST: FUSED_LANES(x); break;
+			case FUSED_TIME: FUSED_LANES(time * x); break;
+			case FUSED_EQUAL: FUSED_LANES(a[i] == b[i] ? 1.0 : 0.0); break;
+			case FUSED_NEQUAL: FUSED_LANES(a[i] != b[i] ? 1.0 : 0.0); break;
+			case FUSED_GREATER: FUSED_LANES(a[i] > b[i] ? 1.0 : 0.0); break;
+			case FUSED_GEQUAL: FUSED_LANES(a[i] >= b[i] ? 1.0 : 0.0); break;
+			case FUSED_LESS: FUSED_LANES(a[i] < b[i] ? 1.0 : 0.0); break;
+			case FUSED_LEQUAL: FUSED_LANES(a[i] <= b[i] ? 1.0 : 0.0); break;
+			case FUSED_AND: FUSED_LANES(a[i] != 0 && b[i] != 0 ? 1.0 : 0.0); break;
+			case FUSED_OR: FUSED_LANES(a[i] != 0 || b[i] != 0 ? 1.0 : 0.0); break;
+			case FUSED_NOT: FUSED_LANES(a[i] == 0 ? 1.0 : 0.0); break;
+			case FUSED_SELECT: FUSED_LANES(a[i] != 0 ? b[i] : c[i]); break;
+			case FUSED_SIN: FUSED_LANES(sin(a[i]) * x + y); break;
+			case FUSED_COS: FUSED_LANES(cos(a[i]) * x + y); break;
+			case FUSED_TAN: FUSED_LANES(tan(a[i]) * x + y); break;
+			case FUSED_ASIN: FUSED_LANES(asin(a[i]) * x + y); break;
+			case FUSED_ACOS: FUSED_LANES(acos(a[i]) * x + y); break;
+			case FUSED_ATAN: FUSED_LANES(atan(a[i]) * x + y); break;
+		}
+	}
+
+	for (unsigned int i = 0; i < output_registers.size(); ++i)
+		memcpy(outputs[i], r + output_registers[i] * num_lanes, num_lanes * sizeof(double));
+}
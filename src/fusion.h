@@ -0,0 +1,64 @@
+#pragma once
+
+#include "litegraph.h"
+
+#include <unordered_map>
+
+namespace LiteGraph {
+
+	//operations of a fused node, every register is a double (bools are 0 or 1)
+	enum FusedOpCode {
+		FUSED_CONST,	//x
+		FUSED_TIME,		//graph time * x
+		FUSED_EQUAL, FUSED_NEQUAL, FUSED_GREATER, FUSED_GEQUAL, FUSED_LESS, FUSED_LEQUAL, FUSED_AND, FUSED_OR, //a op b
+		FUSED_NOT,		//!a
+		FUSED_SELECT,	//a ? b : c
+		FUSED_SIN, FUSED_COS, FUSED_TAN, FUSED_ASIN, FUSED_ACOS, FUSED_ATAN //func(a) * x + y
+	};
+
+	struct LFusedOp {
+		FusedOpCode code;
+		int out;
+		int a, b, c;
+		double x, y;
+	};
+
+	//replaces a group of NODE_FUSABLE nodes in the execution plan (OPTIMIZE_FUSION), the values that go from one
+	//node to another stay in registers. Its inputs read from the nodes outside the group and the nodes outside read from its outputs
+	class LFusedNode : public LGraphNode
+	{
+	public:
+		std::vector<LGraphNode*> members;
+		std::vector<LFusedOp> ops;
+		int num_registers;
+
+		LFusedNode(LGraph* graph);
+		const char* getType() { return "graph/fused"; }
+		void onExecute();
+		void onExecuteLanes(const double* const* inputs, double* const* outputs, int num_lanes);
+
+		bool add(LGraphNode* node); //calls node->onFuse
+		bool contains(LGraphNode* node);
+		void finish(); //creates the outputs read from outside the group and rewires their targets
+
+		//used by the nodes in onFuse
+		int input(LGraphNode* node, int slot, DataType type); //register with the input value, converted like getInputDataAs...
+		int op(FusedOpCode code, int a = -1, int b = -1, int c = -1, double x = 0, double y = 0);
+		void output(LGraphNode* node, int slot, int reg);
+
+	private:
+		std::vector<int> input_registers;
+		std::vector<int> output_registers;
+		std::vector<LSlot*> member_outputs;	//outputs of the fused nodes
+		std::vector<int> member_registers;
+		std::unordered_map<LGraphNode*, int> member_indices;
+		std::unordered_map<LSlot*, int> member_output_indices;
+		std::map<std::pair<LSlot*, int>, int> input_indices; //origin and type
+		std::vector<LSlot*> fused_outputs;	//the output that replaces every member output, NULL if nobody outside reads it
+		std::vector<double> registers;
+		std::vector<double> lanes; //num_registers * num_lanes
+
+		LSlot* getFusedOutput(int index);
+	};
+
+}
@@ -0,0 +1,117 @@
+#include "injection.h"
+
+//bounded MPMC queue by Dmitry Vyukov, every cell sequence tells if it is free to write or ready to read
+
+LiteGraph::LInjectionQueue::LInjectionQueue(int capacity)
+{
+	size_t size = 2;
+	while (size < (size_t)capacity)
+		size *= 2;
+	mask = size - 1;
+	cells = new Cell[size];
+	for (size_t i = 0; i < size; ++i)
+		cells[i].sequence.store(i, std::memory_order_relaxed);
+	enqueue_pos.store(0, std::memory_order_relaxed);
+	dequeue_pos = 0;
+}
+
+LiteGraph::LInjectionQueue::~LInjectionQueue()
+{
+	delete[] cells;
+}
+
+LiteGraph::LInjectionQueue::Item* LiteGraph::LInjectionQueue::claim(size_t& pos)
+{
+	pos = enqueue_pos.load(std::memory_order_relaxed);
+	while (true)
+	{
+		Cell* cell = &cells[pos & mask];
+		size_t sequence = cell->sequence.load(std::memory_order_acquire);
+		intptr_t diff = (intptr_t)sequence - (intptr_t)pos;
+		if (diff == 0)
+		{
+			if (enqueue_pos.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed))
+				return &cell->item;
+		}
+		else if (diff < 0)
+			return NULL; //full
+		else
+			pos = enqueue_pos.load(std::memory_order_relaxed);
+	}
+}
+
+void LiteGraph::LInjectionQueue::publish(size_t pos)
+{
+	cells[pos & mask].sequence.store(pos + 1, std::memory_order_release);
+}
+
+bool LiteGraph::LInjectionQueue::postEvent(int node_id, int slot, const LEvent& event)
+{
+	size_t pos;
+	Item* item = claim(pos);
+	if (!item)
+		return false;
+	item->type = EVENT;
+	item->node_id = node_id;
+	item->slot = slot;
+	item->event = event;
+	publish(pos);
+	return true;
+}
+
+bool LiteGraph::LInjectionQueue::postInput(const char* name, double value)
+{
+	size_t pos;
+	Item* item = claim(pos);
+	if (!item)
+		return false;
+	item->type = INPUT;
+	strcpy_s(item->name, INJECTION_NAME_SIZE, name);
+	item->value_type = DataType::NUMBER;
+	item->number = value;
+	publish(pos);
+	return true;
+}
+
+bool LiteGraph::LInjectionQueue::postInput(const char* name, bool value)
+{
+	size_t pos;
+	Item* item = claim(pos);
+	if (!item)
+		return false;
+	item->type = INPUT;
+	strcpy_s(item->name, INJECTION_NAME_SIZE, name);
+	item->value_type = DataType::BOOL;
+	item->number = value ? 1 : 0;
+	publish(pos);
+	return true;
+}
+
+bool LiteGraph::LInjectionQueue::postInput(const char* name, const char* value)
+{
+	size_t pos;
+	Item* item = claim(pos);
+	if (!item)
+		return false;
+	item->type = INPUT;
+	strcpy_s(item->name, INJECTION_NAME_SIZE, name);
+	item->value_type = DataType::STRING;
+	strcpy_s(item->string, INJECTION_STRING_SIZE, value);
+	publish(pos);
+	return true;
+}
+
+LiteGraph::LInjectionQueue::Item* LiteGraph::LInjectionQueue::front()
+{
+	Cell* cell = &cells[dequeue_pos & mask];
+	size_t sequence = cell->sequence.load(std::memory_order_acquire);
+	if (sequence != dequeue_pos + 1)
+		return NULL;
+	return &cell->item;
+}
+
+void LiteGraph::LInjectionQueue::popFront()
+{
+	cells[dequeue_pos & mask].sequence.store(dequeue_pos + mask + 1, std::memory_order_release);
+	dequeue_pos++;
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include "litegraph.h"
+
+#include <atomic>
+
+#define INJECTION_NAME_SIZE 64
+#define INJECTION_STRING_SIZE 256
+
+namespace LiteGraph {
+
+	//lock-free bounded queue to send events and graph inputs to a running graph from other threads
+	//any thread can post (they never block, post returns false if the queue is full),
+	//the items are consumed by the graph at the beginning of runStep
+	class LInjectionQueue {
+	public:
+		enum ItemType { EVENT, INPUT };
+
+		struct Item {
+			ItemType type;
+			int node_id;	//EVENT
+			int slot;		//EVENT
+			char name[INJECTION_NAME_SIZE]; //INPUT
+			DataType value_type; //INPUT: NUMBER, BOOL or STRING
+			double number;
+			char string[INJECTION_STRING_SIZE];
+			LEvent event;
+		};
+
+		LInjectionQueue(int capacity); //rounded up to power of two
+		~LInjectionQueue();
+
+		//thread safe
+		bool postEvent(int node_id, int slot, const LEvent& event);
+		bool postInput(const char* name, double value);
+		bool postInput(const char* name, bool value);
+		bool postInput(const char* name, const char* value);
+
+		//only for the graph thread
+		Item* front(); //NULL if empty
+		void popFront();
+		int getCapacity() { return (int)(mask + 1); }
+
+	private:
+		struct Cell {
+			std::atomic<size_t> sequence;
+			Item item;
+		};
+
+		Cell* cells;
+		size_t mask;
+		std::atomic<size_t> enqueue_pos;
+		size_t dequeue_pos;
+
+		Item* claim(size_t& pos); //reserves a cell, NULL if full
+		void publish(size_t pos);
+	};
+
+}
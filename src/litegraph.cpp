@@ -4,8 +4,17 @@
 #include <fstream>
 #include <iostream>
 #include <sstream>
+#include <unordered_map>
+#include <deque>
+#include <mutex>
+#include <new>
 
 #include "libs/cJSON.h"
+#include "threadpool.h"
+#include "injection.h"
+#include "fusion.h"
+#include "conversion.h"
+#include "arena.h"
 
 bool LiteGraph::verbose = false;
 std::map<std::string, LiteGraph::LGraphNode*> LiteGraph::node_types;
@@ -35,10 +44,43 @@ std::string LiteGraph::rgb2hex(vec3 color)
     return result;
 }
 
+LiteGraph::LDataBuffer* LiteGraph::LDataBuffer::create(int capacity)
+{
+	size_t alignment = alignof(LDataBuffer);
+	void* allocation = ::operator new(sizeof(LDataBuffer) + capacity + alignment - 1);
+	LDataBuffer* buffer = (LDataBuffer*)(((uintptr_t)allocation + alignment - 1) & ~(uintptr_t)(alignment - 1));
+	new (&buffer->refs) std::atomic<int>(1);
+	buffer->allocation = allocation;
+	buffer->capacity = capacity;
+	buffer->num_items = 0;
+	return buffer;
+}
+
+void LiteGraph::LDataBuffer::release()
+{
+	if (refs.fetch_sub(1, std::memory_order_acq_rel) != 1)
+		return;
+	LData* items = (LData*)getData();
+	for (int i = 0; i < num_items; ++i)
+		items[i].~LData();
+	::operator delete(allocation);
+}
+
 LiteGraph::LData::LData() {
 	type = DataType::NONE;
+	stamp = 0;
 	bytes = 0;
 	custom_data = NULL;
+	heap = NULL;
+}
+
+LiteGraph::LData::LData(const LData& v) {
+	type = DataType::NONE;
+	stamp = 0;
+	bytes = 0;
+	custom_data = NULL;
+	heap = NULL;
+	*this = v;
 }
 
 LiteGraph::LData::~LData()
@@ -48,29 +90,53 @@ LiteGraph::LData::~LData()
 
 void LiteGraph::LData::clear()
 {
-	if (custom_data)
+	release();
+	if (heap)
+		heap->release();
+	heap = NULL;
+}
+
+void LiteGraph::LData::release()
+{
+	if (heap && heap->isShared())
+	{
+		heap->release();
+		heap = NULL;
+	}
+	else if (heap && heap->num_items) //array is the only case that contains pointers
 	{
-		if (bytes)
+		LData* items = (LData*)heap->getData();
+		for (int i = 0; i < heap->num_items; ++i)
+			items[i].~LData();
+		heap->num_items = 0;
+	}
+	//LEvent no need to control, it doesnt contains pointers
+	custom_data = NULL;
+	bytes = 0;
+}
+
+void LiteGraph::LData::reserve(int size, bool allow_inline)
+{
+	if (allow_inline && size <= LDATA_INLINE_SIZE)
+		custom_data = local;
+	else
+	{
+		if (!heap || heap->isShared() || heap->capacity < size)
 		{
-			if (type == DataType::ARRAY) //array is the only case that contains pointers
-			{
-				LData* d = (LData*)custom_data;
-				int num = bytes / sizeof(LData);
-				for (int i = 0; i < num; ++i)
-					d[i].clear();
-			}
-			//LEvent no need to control, it doesnt contains pointers
-			delete[] custom_data;
-			bytes = 0;
+			if (heap)
+				heap->release(); //the other copies keep the old content
+			heap = LDataBuffer::create(size);
 		}
-		custom_data = NULL;
+		custom_data = heap->getData();
 	}
+	bytes = size;
 }
 
 void LiteGraph::LData::setType(DataType type)
 {
 	if (type == this->type)
 		return;
+	release();
 	this->type = type;
 	int size = 0;
 	switch (type)
@@ -80,28 +146,31 @@ void LiteGraph::LData::setType(DataType type)
 		case DataType::EVENT: size = sizeof(LEvent); break;
 		default: size = 0;
 	}
-	if (bytes != size)
-		clear();
 	if (size)
 	{
-		custom_data = (void*)new uint8_t[size];
-		bytes = size;
+		reserve(size);
 		memset(custom_data, 0, bytes);
 	}
 }
 
 void LiteGraph::LData::assign(mat3 v)
 {
+	if (type == DataType::MAT3 && !memcmp(custom_data, &v, bytes))
+		return;
 	if (type != DataType::MAT3)
 		setType(DataType::MAT3);
 	memcpy(custom_data, &v, bytes);
+	++stamp;
 }
 
 void LiteGraph::LData::assign(mat4 v)
 {
+	if (type == DataType::MAT4 && !memcmp(custom_data, &v, bytes))
+		return;
 	if (type != DataType::MAT4)
 		setType(DataType::MAT4);
 	memcpy(custom_data, &v, bytes);
+	++stamp;
 }
 
 void LiteGraph::LData::assign(const LEvent& v)
@@ -110,52 +179,39 @@ void LiteGraph::LData::assign(const LEvent& v)
 		setType(DataType::EVENT);
 	LEvent* e = (LEvent*)custom_data;
 	*e = v;
+	++stamp; //every event is a change, even if it is equal to the previous one
 }
 
 void LiteGraph::LData::assign(const char* str)
 {
 	int l = strlen(str) + 1; //plus one for the '\0' character
+	if (type == DataType::STRING && l == bytes && !memcmp(custom_data, str, l))
+		return;
 	if (type != DataType::STRING)
 		setType(DataType::STRING); //clears
-	if (l != bytes)
-	{
-		clear();
-		custom_data = new char[l];
-		bytes = l;
-	}
-	strcpy_s((char*)custom_data, l, str);
+	reserve(l);
+	memcpy(custom_data, str, l);
+	++stamp;
 }
 
 void LiteGraph::LData::assign(const std::string& str)
 {
-	int l = str.size() + 1; //plus one for the '\0' character
-	if (type != DataType::STRING)
-		setType(DataType::STRING); //clears
-	if (l != bytes)
-	{
-		clear();
-		custom_data = new char[l];
-		bytes = l;
-	}
-	strcpy_s( (char*)custom_data, l, str.c_str());
+	assign(str.c_str());
 }
 
 void LiteGraph::LData::assign(void* pointer, int size)
 {
+	if (type == DataType::OBJECT && pointer && bytes == size && !memcmp(custom_data, pointer, size))
+		return;
 	if (type != DataType::OBJECT)
 		setType(DataType::OBJECT);//clear
-
-	if(bytes != size)
-	{
-		clear();
-		custom_data = (void*)new uint8_t[size];
-		bytes = size;
-	}
+	reserve(size);
 
 	if (pointer)
 		memcpy(custom_data, pointer, bytes);
 	else //allows to send NULL to just allocate space
 		memset(custom_data, 0, bytes); //set to zero
+	++stamp;
 }
 
 template<class T> 
@@ -166,13 +222,21 @@ void LiteGraph::LData::assignObject(const T& obj)
 
 void LiteGraph::LData::assign(const std::vector<LData*>& v)
 {
-	//arrays are converted to an array of data, not pointers of data
+	//arrays are converted to an array of data, not pointers of data (the items share the payloads)
 	setType(DataType::ARRAY);
-	clear();
-	LData* d = new LData[v.size()];
-	for (unsigned int i = 0; i < v.size(); ++i)
-		d[i] = *v[i];
-	custom_data = (void*)d;
+	release();
+	if (v.size())
+	{
+		reserve(v.size() * sizeof(LData), false);
+		LData* d = (LData*)custom_data;
+		for (unsigned int i = 0; i < v.size(); ++i)
+		{
+			::new (d + i) LData();
+			d[i] = *v[i];
+		}
+		heap->num_items = v.size();
+	}
+	++stamp;
 }
 
 std::vector<float> LiteGraph::LData::getArrayOfFloat()
@@ -183,28 +247,30 @@ std::vector<float> LiteGraph::LData::getArrayOfFloat()
 	return v;
 }
 
-std::vector<LiteGraph::LData*> LiteGraph::LData::getArray()
+std::vector<const LiteGraph::LData*> LiteGraph::LData::getArray() const
 {
-	LData* d = (LData*)custom_data;
-	std::vector<LData*> r;
-	unsigned int num = bytes / sizeof(LData*);
+	const LData* d = (const LData*)custom_data;
+	std::vector<const LData*> r;
+	unsigned int num = bytes / sizeof(LData);
 	r.resize(num);
 	for (unsigned int i = 0; i < num; ++i)
 		r[i] = d + i;
 	return r;
 }
 
-std::string LiteGraph::LData::getString()
+std::string LiteGraph::LData::getString() const
 {
-	if (bytes == 0 || type != DataType::STRING) //careful if not null terminates string
-		return NULL;
-	std::string result;
-	result.resize(bytes);
-	strcpy_s(&result[0], bytes, (char*)custom_data );
-	return result;
+	return std::string(getStringView());
+}
+
+std::string_view LiteGraph::LData::getStringView() const
+{
+	if (bytes == 0 || type != DataType::STRING)
+		return std::string_view();
+	return std::string_view((const char*)custom_data, bytes - 1); //without the '\0'
 }
 
-LiteGraph::LEvent LiteGraph::LData::getEvent()
+LiteGraph::LEvent LiteGraph::LData::getEvent() const
 {
 	LEvent e;
 	if (type == DataType::EVENT && bytes) //careful if not null terminates string
@@ -219,24 +285,78 @@ void* const LiteGraph::LData::getPointer()
 	return pointer;
 }
 
-void* LiteGraph::LData::getObject()
+const void* LiteGraph::LData::getObject() const
 {
 	if (type != DataType::OBJECT)
 		return NULL;
 	return custom_data;
 }
 
+void* LiteGraph::LData::editObject()
+{
+	if (type != DataType::OBJECT)
+		return NULL;
+	if (custom_data != local && heap->isShared())
+	{
+		LDataBuffer* old = heap;
+		heap = LDataBuffer::create(bytes);
+		memcpy(heap->getData(), old->getData(), bytes);
+		old->release();
+		custom_data = heap->getData();
+	}
+	++stamp;
+	return custom_data;
+}
+
+void LiteGraph::LData::assignBuffer(BufferType type, const void* values, int length)
+{
+	void* dst = editBuffer(type, length);
+	if (values)
+		memcpy(dst, values, bytes);
+	else
+		memset(dst, 0, bytes);
+}
+
+void* LiteGraph::LData::editBuffer(BufferType type, int length)
+{
+	if (this->type != DataType::BUFFER)
+		setType(DataType::BUFFER);
+	reserve(length * getBufferTypeSize(type), false);
+	buffer.type = type;
+	buffer.length = length;
+	++stamp;
+	return custom_data;
+}
+
+const void* LiteGraph::LData::getBuffer(BufferType& type, int& length)
+{
+	if (this->type != DataType::BUFFER || !custom_data)
+		return NULL;
+	type = buffer.type;
+	length = buffer.length;
+	return custom_data;
+}
+
 void LiteGraph::LData::operator = (const LData& v)
 {
-	clear();
-	memcpy(this, &v, sizeof(LData)); //clone content
-	if (bytes) //clone allocated bytes
+	if (this == &v)
+		return;
+	//stamps are not copied, they belong to the container
+	release();
+	type = v.type;
+	memcpy(local, v.local, sizeof(local)); //clone content of the union
+	bytes = v.bytes;
+	if (v.custom_data == v.local)
+		custom_data = local;
+	else if (v.custom_data) //share the buffer, it is cloned when one of them writes
 	{
-		void* newp = new uint8_t[bytes];
-		memcpy(newp, v.custom_data, bytes);
-		custom_data = newp;
-		//no need to control DataType::ARRAY, as they are not pointers
+		if (heap)
+			heap->release();
+		heap = v.heap;
+		heap->retain();
+		custom_data = heap->getData();
 	}
+	++stamp;
 }
 
 
@@ -270,18 +390,22 @@ LiteGraph::LSlot::~LSlot()
 	}
 }
 
-LiteGraph::LData* LiteGraph::LSlot::getOriginData()
+void LiteGraph::LSlot::resolveOrigin()
 {
+	origin = NULL;
+	origin_data = NULL;
 	//get link
 	if (!link || !node || !node->graph ) //!links.size()
-		return NULL;
+		return;
 	LGraphNode* origin_node = node->graph->getNodeById( link->origin_id );
 	if (!origin_node)
-		return NULL;
-	LSlot* output_slot = origin_node->outputs[link->origin_slot];
+		return;
+	LSlot* output_slot = origin_node->getOutputSlot(link->origin_slot);
 	if (!output_slot)
-		return NULL;
-	return output_slot->data;
+		return;
+	origin = output_slot;
+	origin_data = output_slot->data;
+	output_slot->targets.push_back(this);
 }
 
 
@@ -290,6 +414,7 @@ LiteGraph::LGraphNode::LGraphNode()
 	graph = NULL;
 	id = -1;
 	flags = 0;
+	dirty = true;
 	custom_data = NULL;
 }
 
@@ -317,14 +442,14 @@ LiteGraph::LSlot* LiteGraph::LGraphNode::addOutput(const char* name, LiteGraph::
 
 LiteGraph::LSlot* LiteGraph::LGraphNode::getInputSlot(int i)
 {
-	if (i >= (int)inputs.size())
+	if (i < 0 || i >= (int)inputs.size()) //p.e. -1 from find...SlotIndex
 		return NULL;
 	return inputs[i];
 }
 
 LiteGraph::LSlot* LiteGraph::LGraphNode::getOutputSlot(int i)
 {
-	if (i >= (int)outputs.size())
+	if (i < 0 || i >= (int)outputs.size()) //p.e. -1 from find...SlotIndex
 		return NULL;
 	return outputs[i];
 }
@@ -374,6 +499,22 @@ std::vector<LiteGraph::LGraphNode*> LiteGraph::LGraphNode::getOutputNodes(int sl
 	return result;
 }
 
+bool LiteGraph::LGraphNode::checkInputChanges()
+{
+	bool changed = dirty;
+	dirty = false;
+	for (unsigned int i = 0; i < inputs.size(); ++i)
+	{
+		LSlot* slot = inputs[i];
+		unsigned int stamp = slot->origin_data ? slot->origin_data->stamp : 0;
+		if (slot->stamp == stamp)
+			continue;
+		slot->stamp = stamp;
+		changed = true;
+	}
+	return changed;
+}
+
 bool LiteGraph::LGraphNode::isInputConnected(int index)
 {
 	LSlot* slot = getInputSlot(index);
@@ -404,9 +545,13 @@ void LiteGraph::LGraphNode::connect(int output_slot, LiteGraph::LGraphNode* targ
 
 	//Persist changes
 	graph->links.push_back(link);
-	graph->links_by_id[id] = link;
+	graph->links_by_id[link->id] = link;
 	source->links.push_back(link);
 	target->link = link;
+	target->origin = source;
+	target->origin_data = source->data;
+	source->targets.push_back(target);
+	graph->invalidateExecutionPlan();
 
 	//Log
 	if (LiteGraph::verbose) {
@@ -419,6 +564,8 @@ void LiteGraph::LGraphNode::connect(int output_slot, LiteGraph::LGraphNode* targ
 void LiteGraph::LGraphNode::disconnectInput(int input_slot) {
 	auto* slot = inputs[input_slot];
 	assert(slot != nullptr && "Slot index not found");
+	if (!slot->link)
+		return;
 
 	{//Remove from graph
 		graph->links_by_id.erase(slot->link->id);
@@ -432,13 +579,20 @@ void LiteGraph::LGraphNode::disconnectInput(int input_slot) {
 		auto it = std::find(link_source_slot->links.begin(), link_source_slot->links.end(), slot->link);
 		if (it != link_source_slot->links.end())
 			link_source_slot->links.erase(it);
+		auto it2 = std::find(link_source_slot->targets.begin(), link_source_slot->targets.end(), slot);
+		if (it2 != link_source_slot->targets.end())
+			link_source_slot->targets.erase(it2);
 	}
 
 	{//Remove from target
 		auto* link_target_slot = graph->getNodeById(slot->link->target_id)->getInputSlot(slot->link->target_slot);
 		delete link_target_slot->link;
 		link_target_slot->link = nullptr;
+		link_target_slot->origin = nullptr;
+		link_target_slot->origin_data = nullptr;
 	}
+
+	graph->invalidateExecutionPlan();
 }
 
 void LiteGraph::LGraphNode::disconnectOutput(int output_slot) {
@@ -480,23 +634,33 @@ double LiteGraph::LGraphNode::getInputDataAsNumber(int index)
 }
 
 std::string LiteGraph::LGraphNode::getInputDataAsString(int index)
+{
+	return std::string(getInputDataAsStringView(index));
+}
+
+std::string_view LiteGraph::LGraphNode::getInputDataAsStringView(int index)
 {
 	LSlot* slot = getInputSlot(index);
 	if (!slot)
-		return "";
+		return std::string_view();
 	LData* data = slot->getOriginData();
 	if (data == NULL)
-		return "";
+		return std::string_view();
 	if (data->type == DataType::STRING)
-		return data->getString();
+		return data->getStringView();
 	else if (data->type == DataType::NUMBER)
 	{
-		std::ostringstream ss;
-		ss << data->number;
-		std::string s(ss.str());
-		return s;
+		if (!slot->has_number_text || slot->number_text_value != data->number)
+		{
+			char buffer[32];
+			snprintf(buffer, sizeof(buffer), "%g", data->number); //same format than std::ostream
+			slot->number_text = buffer;
+			slot->number_text_value = data->number;
+			slot->has_number_text = true;
+		}
+		return slot->number_text;
 	}
-	return "";
+	return std::string_view();
 }
 
 LiteGraph::JSON LiteGraph::LGraphNode::getInputDataAsJSON(int index)
@@ -536,11 +700,9 @@ void LiteGraph::LGraphNode::setOutputDataAsBoolean(int index, const bool& v)
 	if (!slot)
 		return;
 	LData* data = slot->data;
-	if (data == NULL || (slot->type != DataType::BOOL && slot->type != DataType::ANY))
-	{
-		std::cout << "output data dont match: " << slot->type << " expected BOOLEAN " << std::endl;
+	if (data == NULL)
 		return;
-	}
+	assert((slot->type == DataType::BOOL || slot->type == DataType::ANY) && "output type doesnt match, slot types are checked when the plan is built");
 	data->assign(v);
 }
 
@@ -550,11 +712,9 @@ void LiteGraph::LGraphNode::setOutputDataAsNumber(int index, const int& v)
 	if (!slot)
 		return;
 	LData* data = slot->data;
-	if (data == NULL || (slot->type != DataType::NUMBER && slot->type != DataType::ANY))
-	{
-		std::cout << "output data dont match: " << slot->type << " expected NUMBER " << std::endl;
+	if (data == NULL)
 		return;
-	}
+	assert((slot->type == DataType::NUMBER || slot->type == DataType::ANY) && "output type doesnt match, slot types are checked when the plan is built");
 	data->assign(v);
 }
 
@@ -564,11 +724,9 @@ void LiteGraph::LGraphNode::setOutputDataAsNumber(int index, const float& v)
 	if (!slot)
 		return;
 	LData* data = slot->data;
-	if (data == NULL || (slot->type != DataType::NUMBER && slot->type != DataType::ANY))
-	{
-		std::cout << "output data dont match: " << slot->type << " expected NUMBER " << std::endl;
+	if (data == NULL)
 		return;
-	}
+	assert((slot->type == DataType::NUMBER || slot->type == DataType::ANY) && "output type doesnt match, slot types are checked when the plan is built");
 	data->assign(v);
 }
 
@@ -578,11 +736,9 @@ void LiteGraph::LGraphNode::setOutputDataAsNumber(int index, const double& v)
 	if (!slot)
 		return;
 	LData* data = slot->data;
-	if (data == NULL || (slot->type != DataType::NUMBER && slot->type != DataType::ANY))
-	{
-		std::cout << "output data dont match: " << slot->type << " expected NUMBER " << std::endl;
+	if (data == NULL)
 		return;
-	}
+	assert((slot->type == DataType::NUMBER || slot->type == DataType::ANY) && "output type doesnt match, slot types are checked when the plan is built");
 	data->assign(v);
 }
 
@@ -593,11 +749,9 @@ void LiteGraph::LGraphNode::setOutputDataAsString(int index, const char* v)
 	if (!slot)
 		return;
 	LData* data = slot->data;
-	if (data == NULL || (slot->type != DataType::STRING && slot->type != DataType::ANY) )
-	{
-		std::cout << "output data dont match: " << slot->type << " expected STRING " << std::endl;
+	if (data == NULL)
 		return;
-	}
+	assert((slot->type == DataType::STRING || slot->type == DataType::ANY) && "output type doesnt match, slot types are checked when the plan is built");
 	data->assign(v);
 }
 
@@ -607,11 +761,9 @@ void LiteGraph::LGraphNode::setOutputDataAsPointer(int index, void* v)
 	if (!slot)
 		return;
 	LData* data = slot->data;
-	if (data == NULL || slot->type != DataType::POINTER)
-	{
-		std::cout << "output data dont match: " << slot->type << " expected POINTER " << std::endl;
+	if (data == NULL)
 		return;
-	}
+	assert(slot->type == DataType::POINTER && "output type doesnt match, slot types are checked when the plan is built");
 	data->assign(v);
 }
 
@@ -621,11 +773,9 @@ void LiteGraph::LGraphNode::setOutputDataAsEvent(int index, const LEvent& event)
 	if (!slot)
 		return;
 	LData* data = slot->data;
-	if (data == NULL || (slot->type != DataType::EVENT && slot->type != DataType::ANY))
-	{
-		std::cout << "output data dont match: " << slot->type << " expected EVENT " << std::endl;
+	if (data == NULL)
 		return;
-	}
+	assert((slot->type == DataType::EVENT || slot->type == DataType::ANY) && "output type doesnt match, slot types are checked when the plan is built");
 	data->assign(event);
 }
 
@@ -635,20 +785,20 @@ void LiteGraph::LGraphNode::trigger(int index, const LEvent& event)
 	if (!slot)
 		return;
 	LData* data = slot->data;
-	if (data == NULL || (slot->type != DataType::EVENT && slot->type != DataType::ANY))
-	{
-		std::cout << "output data dont match: " << slot->type << " expected EVENT " << std::endl;
+	if (data == NULL)
 		return;
-	}
+	assert((slot->type == DataType::EVENT || slot->type == DataType::ANY) && "output type doesnt match, slot types are checked when the plan is built");
 	data->assign(event);
 
-	for (unsigned int i = 0; i < slot->links.size(); ++i)
+	for (unsigned int i = 0; i < slot->targets.size(); ++i)
 	{
-		LLink* link = slot->links[i];
-		LGraphNode* target_node = graph->getNodeById(link->target_id);
-		if (!target_node)
-			continue; //???
-		target_node->onAction( link->target_slot, event );
+		LSlot* target = slot->targets[i];
+		LGraphNode* target_node = target->node;
+		int target_slot = target->link->target_slot;
+		if (graph->event_queue)
+			graph->event_queue->push(target_node, target_slot, event, graph->event_depth + 1);
+		else
+			target_node->onAction( target_slot, event );
 	}
 }
 
@@ -683,6 +833,7 @@ LiteGraph::LLink::LLink(int id, int origin_id, int origin_slot, int target_id, i
 	this->origin_slot = origin_slot;
 	this->target_id = target_id;
 	this->target_slot = target_slot;
+	feedback = false;
 }
 
 LiteGraph::LGraph::LGraph()
@@ -691,14 +842,43 @@ LiteGraph::LGraph::LGraph()
 	last_node_id = 0;
 	last_link_id = 0;
 	has_errors = false;
+	plan_dirty = true;
+	time = 0;
 	custom_data = NULL;
+	thread_pool = NULL;
+	parallel_min_nodes = 64;
+	parallel_grain = 16;
+	incremental = false;
+	event_queue = NULL;
+	max_event_depth = 16;
+	max_events_per_step = 4096;
+	event_depth = -1;
+	injection_queue = NULL;
+	optimizations = 0;
+	wire_data = NULL;
+	num_wires = 0;
+	arena = NULL;
 }
 
 LiteGraph::LGraph::~LGraph()
 {
+	delete event_queue;
+	delete injection_queue;
+	unpackWires();
+	clearFusedNodes();
+	clearConversionNodes();
+	for (auto it = inputs.begin(); it != inputs.end(); ++it)
+		delete it->second;
 	for (int i = 0; i < nodes.size(); ++i)
 		delete nodes[i];
 	nodes.clear();
+	delete arena;
+}
+
+void LiteGraph::LGraph::enableArena(size_t block_size)
+{
+	if (!arena)
+		arena = new LArena(block_size);
 }
 
 void LiteGraph::LGraph::add(LGraphNode* node)
@@ -710,6 +890,7 @@ void LiteGraph::LGraph::add(LGraphNode* node)
 		node->id = last_node_id++;
 	node->order = node->id;
 	nodes_by_id[ node->id ] = node;
+	plan_dirty = true;
 }
 
 LiteGraph::LGraphNode* LiteGraph::LGraph::getNodeById(int id)
@@ -723,6 +904,9 @@ LiteGraph::LGraphNode* LiteGraph::LGraph::getNodeById(int id)
 void LiteGraph::LGraph::clear()
 {
 	has_errors = false;
+	unpackWires(); //before the slots are deleted
+	clearFusedNodes();
+	clearConversionNodes();
 
 	//free
 	for (unsigned int i = 0; i < nodes.size(); ++i)
@@ -736,30 +920,838 @@ void LiteGraph::LGraph::clear()
 	links.clear();
 	links_by_id.clear();
 	nodes_in_execution_order.clear();
+	execution_levels.clear();
+	inlined_graphs.clear();
+	outputs.clear(); //they point to the data of the nodes
 	last_link_id = 0;
 	last_node_id = 0;
 	outputs.clear();
+	for (auto it = inputs.begin(); it != inputs.end(); ++it)
+		delete it->second;
+	inputs.clear();
+	if (event_queue)
+		event_queue->pop(event_queue->count);
+	if (arena)
+		arena->reset(); //everything allocated there has been deleted
+	plan_dirty = true;
+}
+
+//in incremental mode the nodes whose inputs didnt change since their last execution are skipped
+static inline void executeNode(LiteGraph::LGraphNode* node, bool incremental)
+{
+	if (incremental && !(node->flags & LiteGraph::NODE_ALWAYS_RUN) && !node->checkInputChanges())
+		return;
+	node->onExecute();
+}
+
+//consecutive nodes with the same batch kernel are executed with a single call
+static inline void executeRange(LiteGraph::LGraphNode** nodes, const int* batch_ends, int start, int end, bool incremental)
+{
+	for (int i = start; i < end;)
+	{
+		int batch_end = batch_ends ? std::min(batch_ends[i], end) : i + 1;
+		if (batch_end - i > 1 && !incremental)
+		{
+			nodes[i]->getBatchKernel()(nodes + i, batch_end - i);
+			i = batch_end;
+			continue;
+		}
+		executeNode(nodes[i], incremental);
+		++i;
+	}
 }
 
 void LiteGraph::LGraph::runStep(float dt)
 {
+	if (plan_dirty)
+		buildExecutionPlan();
+
+	if (injection_queue)
+		consumeInjected();
+
+	for (unsigned int i = 0; i < inlined_graphs.size(); ++i)
+		inlined_graphs[i]->time = time;
+
+	const int* batch_ends = this->batch_ends.size() ? &this->batch_ends[0] : NULL;
+	if (!thread_pool || nodes_in_execution_order.size() < parallel_min_nodes)
+	{
+		if (nodes_in_execution_order.size())
+			executeRange(&nodes_in_execution_order[0], batch_ends, 0, (int)nodes_in_execution_order.size(), incremental);
+		if (event_queue)
+			dispatchEvents();
+		time += dt;
+		return;
+	}
+
+	//wavefront: every level waits for the previous one
+	LGraphNode** level_nodes = &nodes_in_execution_order[0];
+	for (unsigned int i = 0; i < execution_levels.size(); ++i)
+	{
+		LExecutionLevel& level = execution_levels[i];
+		int num_parallel = level.parallel_end - level.start;
+		int j = level.start;
+		if (num_parallel >= parallel_min_nodes)
+		{
+			bool incremental = this->incremental;
+			thread_pool->parallelFor(num_parallel, parallel_grain, [level_nodes, batch_ends, &level, incremental](int start, int end) {
+				executeRange(level_nodes, batch_ends, level.start + start, level.start + end, incremental);
+			});
+			j = level.parallel_end;
+		}
+		executeRange(level_nodes, batch_ends, j, level.end, incremental);
+	}
+	if (event_queue)
+		dispatchEvents();
+	time += dt;
+}
+
+void LiteGraph::LGraph::enableInjection(int capacity)
+{
+	delete injection_queue;
+	injection_queue = capacity > 0 ? new LInjectionQueue(capacity) : NULL;
+}
+
+//at most one queue worth of items, so producers cannot stall the step
+void LiteGraph::LGraph::consumeInjected()
+{
+	int num = injection_queue->getCapacity();
+	LInjectionQueue::Item* item;
+	while (num-- && (item = injection_queue->front()))
+	{
+		if (item->type == LInjectionQueue::EVENT)
+		{
+			LGraphNode* node = getNodeById(item->node_id);
+			if (node && node->getInputSlot(item->slot))
+			{
+				if (event_queue)
+					event_queue->push(node, item->slot, item->event, 0);
+				else
+					node->onAction(item->slot, item->event);
+			}
+		}
+		else
+		{
+			LData* data = getInput(item->name);
+			if (item->value_type == DataType::STRING)
+				data->assign(item->string);
+			else if (item->value_type == DataType::BOOL)
+				data->assign(item->number != 0);
+			else
+				data->assign(item->number);
+		}
+		injection_queue->popFront();
+	}
+}
+
+void LiteGraph::LGraph::enableEventQueue(int capacity)
+{
+	if (event_queue)
+	{
+		dispatchEvents();
+		delete event_queue;
+	}
+	event_queue = capacity > 0 ? new LEventQueue(capacity) : NULL;
+}
+
+//dispatches in batches: the events pending when the batch starts, sorted by target in execution order
+//events triggered during a batch go to the next one, until the budget of the step is consumed
+void LiteGraph::LGraph::dispatchEvents()
+{
+	int budget = max_events_per_step;
+	std::vector<int>& batch = event_queue->batch;
+	while (event_queue->count && budget > 0)
+	{
+		int num = event_queue->count < budget ? event_queue->count : budget;
+		batch.resize(num);
+		for (int i = 0; i < num; ++i)
+			batch[i] = i;
+		LEventQueue* queue = event_queue;
+		std::sort(batch.begin(), batch.end(), [queue](int a, int b) {
+			int order_a = queue->get(a).node->order;
+			int order_b = queue->get(b).node->order;
+			return order_a < order_b || (order_a == order_b && a < b);
+		});
+
+		for (int i = 0; i < num; ++i)
+		{
+			LEventQueue::Item& item = event_queue->get(batch[i]);
+			event_depth = item.depth;
+			item.node->onAction(item.slot, item.event);
+		}
+		event_depth = -1;
+		event_queue->pop(num);
+		budget -= num;
+	}
+}
+
+//Kahn's algorithm over the resolved input slots, O(nodes + links)
+//when a cycle is found the first pending node (in graph order) is executed anyway,
+//its inputs coming from pending nodes become feedback links that read last step's data
+void LiteGraph::LGraph::sortByExecutionOrder()
+{
+	int num = (int)nodes.size();
+	for (int i = 0; i < num; ++i)
+		nodes[i]->order = i; //used as index during the sort
+
+	//successors stored contiguously (compressed adjacency)
+	std::vector<int> pending_inputs(num, 0);
+	std::vector<int> first_successor(num + 1, 0);
+	for (int i = 0; i < num; ++i)
+	{
+		LGraphNode* node = nodes[i];
+		for (unsigned int j = 0; j < node->inputs.size(); ++j)
+		{
+			LSlot* slot = node->inputs[j];
+			if (slot->link)
+				slot->link->feedback = false;
+			if (!slot->origin || slot->origin->node->graph != this)
+				continue;
+			pending_inputs[i]++;
+			first_successor[slot->origin->node->order + 1]++;
+		}
+	}
+	for (int i = 0; i < num; ++i)
+		first_successor[i + 1] += first_successor[i];
+	std::vector<int> successors(first_successor[num]);
+	std::vector<int> fill(first_successor.begin(), first_successor.end() - 1);
+	for (int i = 0; i < num; ++i)
+	{
+		LGraphNode* node = nodes[i];
+		for (unsigned int j = 0; j < node->inputs.size(); ++j)
+		{
+			LSlot* slot = node->inputs[j];
+			if (slot->origin && slot->origin->node->graph == this)
+				successors[fill[slot->origin->node->order]++] = i;
+		}
+	}
+
+	nodes_in_execution_order.clear();
+	nodes_in_execution_order.reserve(num);
+	std::vector<bool> done(num, false);
+	std::vector<int> ready;
+	ready.reserve(num);
+	for (int i = 0; i < num; ++i)
+		if (pending_inputs[i] == 0)
+			ready.push_back(i);
+
+	unsigned int next_ready = 0;
+	int next_pending = 0;
+	while ((int)nodes_in_execution_order.size() < num)
+	{
+		if (next_ready == ready.size()) //cycle
+		{
+			while (done[next_pending] || pending_inputs[next_pending] <= 0)
+				++next_pending;
+			LGraphNode* node = nodes[next_pending];
+			for (unsigned int j = 0; j < node->inputs.size(); ++j)
+			{
+				LSlot* slot = node->inputs[j];
+				if (!slot->origin || slot->origin->node->graph != this || done[slot->origin->node->order])
+					continue;
+				slot->link->feedback = true;
+				if (LiteGraph::verbose)
+					std::cout << "feedback link: " << slot->link->origin_id << " -> " << node->id << std::endl;
+			}
+			pending_inputs[next_pending] = 0;
+			ready.push_back(next_pending);
+		}
+
+		int index = ready[next_ready++];
+		done[index] = true;
+		nodes_in_execution_order.push_back(nodes[index]);
+		for (int j = first_successor[index]; j < first_successor[index + 1]; ++j)
+		{
+			int target = successors[j];
+			if (--pending_inputs[target] == 0 && !done[target])
+				ready.push_back(target);
+		}
+	}
+
+	for (int i = 0; i < num; ++i)
+		nodes_in_execution_order[i]->order = i;
+}
+
+void LiteGraph::LGraph::buildExecutionPlan()
+{
+	unpackWires();
+	clearFusedNodes();
+	clearConversionNodes();
+
+	//resolve every input to the data it reads from, so running a step doesnt touch nodes_by_id
+	for (unsigned int i = 0; i < nodes.size(); ++i)
+		for (unsigned int j = 0; j < nodes[i]->outputs.size(); ++j)
+			nodes[i]->outputs[j]->targets.clear();
+	for (unsigned int i = 0; i < nodes.size(); ++i)
+	{
+		LGraphNode* node = nodes[i];
+		for (unsigned int j = 0; j < node->inputs.size(); ++j)
+			node->inputs[j]->resolveOrigin();
+		node->dirty = true; //topology changed, run everything once
+	}
+
+	sortByExecutionOrder();
+	if (optimizations & OPTIMIZE_INLINE_SUBGRAPHS)
+		inlineSubgraphs();
+	resolveSlotTypes();
+	if (optimizations & OPTIMIZE_MERGE_DUPLICATES)
+		mergeDuplicateNodes();
+	bindPorts(); //folding executes nodes
+	if (optimizations & OPTIMIZE_CONSTANT_FOLDING)
+		foldConstants();
+	if (optimizations & OPTIMIZE_DEAD_NODES)
+		removeDeadNodes();
+	if (optimizations & OPTIMIZE_FUSION)
+		fuseNodes();
+	buildExecutionLevels();
+	batch_ends.clear();
+	if (optimizations & OPTIMIZE_BATCH_KERNELS)
+		groupBatchKernels();
+	if (optimizations & OPTIMIZE_PACKED_WIRES)
+		packWires();
+	bindPorts();
+	for (unsigned int i = 0; i < nodes_in_execution_order.size(); ++i)
+		nodes_in_execution_order[i]->onPlanBuilt();
+	plan_dirty = false;
+}
+
+//nodes not executed by this plan are left with order -1
+void LiteGraph::LGraph::inlineSubgraphs()
+{
+	inlined_graphs.clear();
+	std::vector<LGraphNode*> execution_order;
+	execution_order.reserve(nodes_in_execution_order.size());
+	for (unsigned int i = 0; i < nodes_in_execution_order.size(); ++i)
+	{
+		LGraphNode* node = nodes_in_execution_order[i];
+		if (node->onInline(execution_order))
+			node->order = -1;
+		else
+			execution_order.push_back(node);
+	}
+	nodes_in_execution_order.swap(execution_order);
+	for (unsigned int i = 0; i < nodes_in_execution_order.size(); ++i)
+		nodes_in_execution_order[i]->order = i;
+}
+
+//ANY slots take the type of their links, and the links between different types that can be converted go through
+//a LConversionNode placed before the target, the rest are reported together
+void LiteGraph::LGraph::resolveSlotTypes()
+{
+	type_errors.clear();
+
+	//an ANY output takes the type of its targets if they all agree
 	for (unsigned int i = 0; i < nodes_in_execution_order.size(); ++i)
 	{
 		LGraphNode* node = nodes_in_execution_order[i];
+		for (unsigned int j = 0; j < node->outputs.size(); ++j)
+		{
+			LSlot* output = node->outputs[j];
+			output->resolved_type = node->flags & NODE_HOST_TYPED ? DataType::ANY : output->type;
+			if (output->resolved_type != DataType::ANY)
+				continue;
+			for (unsigned int k = 0; k < output->targets.size(); ++k)
+			{
+				DataType type = output->targets[k]->type;
+				if (type == DataType::ANY || type == output->resolved_type)
+					continue;
+				if (output->resolved_type != DataType::ANY)
+				{
+					output->resolved_type = DataType::ANY; //they dont agree
+					break;
+				}
+				output->resolved_type = type;
+			}
+		}
+	}
+
+	std::map<std::pair<LSlot*, int>, LConversionNode*> conversions; //origin and type, shared by the targets
+	std::vector<LGraphNode*> execution_order;
+	execution_order.reserve(nodes_in_execution_order.size());
+	for (unsigned int i = 0; i < nodes_in_execution_order.size(); ++i)
+	{
+		LGraphNode* node = nodes_in_execution_order[i];
+		for (unsigned int j = 0; j < node->inputs.size(); ++j)
+		{
+			LSlot* input = node->inputs[j];
+			LSlot* origin = input->origin;
+			input->resolved_type = input->type;
+			if (!origin)
+				continue;
+			if (input->type == DataType::ANY || (node->flags & NODE_HOST_TYPED))
+			{
+				input->resolved_type = origin->resolved_type;
+				continue;
+			}
+			DataType from = origin->resolved_type;
+			if (from == DataType::ANY || from == input->type)
+				continue;
+			if (!LConversionNode::canConvert(from, input->type) || origin->node->order >= node->order)
+			{
+				std::ostringstream error;
+				error << "node " << origin->node->id << " (" << origin->node->getType() << ") output '" << origin->name << "' is " << typeToString(from)
+					<< ", node " << node->id << " (" << node->getType() << ") input '" << input->name << "' expects " << typeToString(input->type);
+				type_errors.push_back(error.str());
+				continue;
+			}
+
+			std::pair<LSlot*, int> key(origin, (int)input->type);
+			LConversionNode* conversion = conversions[key];
+			if (!conversion)
+			{
+				conversion = new LConversionNode(this, from, input->type);
+				conversion->inputs[0]->origin = origin;
+				conversion->inputs[0]->origin_data = input->origin_data;
+				origin->targets.push_back(conversion->inputs[0]);
+				conversion_nodes.push_back(conversion);
+				conversions[key] = conversion;
+				execution_order.push_back(conversion);
+			}
+			std::vector<LSlot*>& targets = origin->targets;
+			targets.erase(std::find(targets.begin(), targets.end(), input));
+			LSlot* output = conversion->outputs[0];
+			input->origin = output;
+			input->origin_data = output->data;
+			output->targets.push_back(input);
+		}
+		execution_order.push_back(node);
+	}
+
+	if (conversion_nodes.size())
+	{
+		nodes_in_execution_order.swap(execution_order);
+		for (unsigned int i = 0; i < nodes_in_execution_order.size(); ++i)
+			nodes_in_execution_order[i]->order = i;
+	}
+
+	has_errors = type_errors.size() > 0; //cleared when the links are fixed
+	if (type_errors.size())
+	{
+		std::cout << "links with incompatible types: " << type_errors.size() << std::endl;
+		for (unsigned int i = 0; i < type_errors.size(); ++i)
+			std::cout << "\t" << type_errors[i] << std::endl;
+	}
+}
+
+void LiteGraph::LGraph::bindPorts()
+{
+	for (unsigned int i = 0; i < nodes_in_execution_order.size(); ++i)
+	{
+		std::vector<LPort*>& ports = nodes_in_execution_order[i]->ports;
+		for (unsigned int j = 0; j < ports.size(); ++j)
+			ports[j]->bind();
+	}
+}
+
+//removes the links of a node created by the plan, so the slots of the graph dont keep pointers to it
+static void detachPlanNode(LiteGraph::LGraphNode* node)
+{
+	for (unsigned int i = 0; i < node->inputs.size(); ++i)
+	{
+		LiteGraph::LSlot* input = node->inputs[i];
+		if (!input->origin)
+			continue;
+		std::vector<LiteGraph::LSlot*>& targets = input->origin->targets;
+		targets.erase(std::remove(targets.begin(), targets.end(), input), targets.end());
+	}
+	for (unsigned int i = 0; i < node->outputs.size(); ++i)
+	{
+		std::vector<LiteGraph::LSlot*>& targets = node->outputs[i]->targets;
+		for (unsigned int j = 0; j < targets.size(); ++j)
+		{
+			targets[j]->origin = NULL; //resolved again by the next plan
+			targets[j]->origin_data = NULL;
+		}
+		targets.clear();
+	}
+}
+
+void LiteGraph::LGraph::clearConversionNodes()
+{
+	for (unsigned int i = 0; i < conversion_nodes.size(); ++i)
+		detachPlanNode(conversion_nodes[i]);
+	for (unsigned int i = 0; i < conversion_nodes.size(); ++i)
+		delete conversion_nodes[i];
+	conversion_nodes.clear();
+}
+
+//pure nodes whose inputs are unconnected or come from folded nodes are executed now and removed from the plan,
+//their outputs keep the value so the targets read it as any other input
+void LiteGraph::LGraph::foldConstants()
+{
+	int num = (int)nodes_in_execution_order.size();
+	std::vector<bool> folded(num, false);
+	std::vector<LGraphNode*> execution_order;
+	execution_order.reserve(num);
+	for (int i = 0; i < num; ++i)
+	{
+		LGraphNode* node = nodes_in_execution_order[i];
+		bool constant = (node->flags & NODE_PURE) && !(node->flags & NODE_ALWAYS_RUN);
+		for (unsigned int j = 0; j < node->inputs.size() && constant; ++j)
+		{
+			LSlot* slot = node->inputs[j];
+			if (!slot->origin)
+				continue;
+			int origin_order = slot->origin->node->order;
+			constant = origin_order >= 0 && origin_order < num && folded[origin_order]; //feedback origins are not folded yet
+		}
+		if (!constant)
+		{
+			execution_order.push_back(node);
+			continue;
+		}
 		node->onExecute();
+		node->dirty = false;
+		folded[i] = true;
 	}
-	time += dt;
+
+	for (int i = 0; i < num; ++i)
+		if (folded[i])
+			nodes_in_execution_order[i]->order = -1;
+	nodes_in_execution_order.swap(execution_order);
+	for (unsigned int i = 0; i < nodes_in_execution_order.size(); ++i)
+		nodes_in_execution_order[i]->order = i;
 }
 
-bool comp_func(LiteGraph::LGraphNode* a, LiteGraph::LGraphNode* b)
+//pure nodes are identified by type, signature and the outputs they read, the duplicates are removed from the plan
+//and their targets read from the first one. Nodes are visited in execution order so chains of duplicates merge too
+void LiteGraph::LGraph::mergeDuplicateNodes()
 {
-	return a->order < b->order;
+	std::unordered_map<std::string, LGraphNode*> unique_nodes;
+	std::vector<LGraphNode*> execution_order;
+	execution_order.reserve(nodes_in_execution_order.size());
+	std::string key;
+	for (unsigned int i = 0; i < nodes_in_execution_order.size(); ++i)
+	{
+		LGraphNode* node = nodes_in_execution_order[i];
+		key = node->getType();
+		key += '\0';
+		if (!(node->flags & NODE_PURE) || (node->flags & NODE_ALWAYS_RUN) || !node->getSignature(key))
+		{
+			execution_order.push_back(node);
+			continue;
+		}
+		key += '\0';
+		for (unsigned int j = 0; j < node->inputs.size(); ++j)
+			key.append((const char*)&node->inputs[j]->origin, sizeof(LSlot*));
+
+		auto it = unique_nodes.find(key);
+		if (it == unique_nodes.end() || it->second->outputs.size() != node->outputs.size())
+		{
+			unique_nodes[key] = node;
+			execution_order.push_back(node);
+			continue;
+		}
+
+		LGraphNode* unique_node = it->second;
+		for (unsigned int j = 0; j < node->outputs.size(); ++j)
+		{
+			LSlot* output = unique_node->outputs[j];
+			std::vector<LSlot*>& targets = node->outputs[j]->targets;
+			for (unsigned int k = 0; k < targets.size(); ++k)
+			{
+				targets[k]->origin = output;
+				targets[k]->origin_data = output->data;
+				output->targets.push_back(targets[k]);
+			}
+			targets.clear();
+		}
+		node->order = -1;
+	}
+
+	nodes_in_execution_order.swap(execution_order);
+	for (unsigned int i = 0; i < nodes_in_execution_order.size(); ++i)
+		nodes_in_execution_order[i]->order = i;
 }
 
-void LiteGraph::LGraph::sortByExecutionOrder()
+//marks as alive the nodes with side effects (outputs, watches, events...) and everything they read from,
+//the rest is removed from the plan with order -1. The plan is rebuilt when a link changes so it is applied again
+void LiteGraph::LGraph::removeDeadNodes()
 {
-	nodes_in_execution_order = std::vector<LGraphNode*>( nodes.begin(), nodes.end() );
-	std::sort(nodes_in_execution_order.begin(), nodes_in_execution_order.end(), comp_func);
+	int num = (int)nodes_in_execution_order.size();
+	std::vector<bool> alive(num, false);
+	std::vector<int> pending;
+	for (int i = 0; i < num; ++i)
+	{
+		if (nodes_in_execution_order[i]->flags & (NODE_PURE | NODE_NO_SIDE_EFFECTS))
+			continue;
+		alive[i] = true;
+		pending.push_back(i);
+	}
+
+	while (pending.size())
+	{
+		LGraphNode* node = nodes_in_execution_order[pending.back()];
+		pending.pop_back();
+		for (unsigned int j = 0; j < node->inputs.size(); ++j)
+		{
+			LSlot* slot = node->inputs[j];
+			if (!slot->origin)
+				continue;
+			int origin_order = slot->origin->node->order;
+			if (origin_order < 0 || origin_order >= num || alive[origin_order]) //not in the plan (folded) or already visited
+				continue;
+			alive[origin_order] = true;
+			pending.push_back(origin_order);
+		}
+	}
+
+	std::vector<LGraphNode*> execution_order;
+	execution_order.reserve(num);
+	for (int i = 0; i < num; ++i)
+	{
+		if (alive[i])
+			execution_order.push_back(nodes_in_execution_order[i]);
+		else
+			nodes_in_execution_order[i]->order = -1;
+	}
+	nodes_in_execution_order.swap(execution_order);
+	for (unsigned int i = 0; i < nodes_in_execution_order.size(); ++i)
+		nodes_in_execution_order[i]->order = i;
+}
+
+//a group of a single node is left as it was
+static void closeFusedGroup(LiteGraph::LFusedNode* group, std::vector<LiteGraph::LGraphNode*>& execution_order, std::vector<LiteGraph::LFusedNode*>& fused_nodes)
+{
+	if (group->members.size() < 2)
+	{
+		if (group->members.size())
+			execution_order.push_back(group->members[0]);
+		delete group;
+		return;
+	}
+	group->finish();
+	for (unsigned int i = 0; i < group->members.size(); ++i)
+		group->members[i]->order = -1;
+	fused_nodes.push_back(group);
+	execution_order.push_back(group);
+}
+
+//a node that is not fusable closes the current group if it reads from it, otherwise it is executed before the fused node,
+//which takes the place of the last node of the group
+void LiteGraph::LGraph::fuseNodes()
+{
+	std::vector<LGraphNode*> execution_order;
+	execution_order.reserve(nodes_in_execution_order.size());
+	LFusedNode* group = new LFusedNode(this);
+	for (unsigned int i = 0; i < nodes_in_execution_order.size(); ++i)
+	{
+		LGraphNode* node = nodes_in_execution_order[i];
+		if ((node->flags & NODE_FUSABLE) && group->add(node))
+			continue;
+		for (unsigned int j = 0; j < node->inputs.size(); ++j)
+		{
+			LSlot* origin = node->inputs[j]->origin;
+			if (origin && group->contains(origin->node))
+			{
+				closeFusedGroup(group, execution_order, fused_nodes);
+				group = new LFusedNode(this);
+				break;
+			}
+		}
+		execution_order.push_back(node);
+	}
+	closeFusedGroup(group, execution_order, fused_nodes);
+
+	nodes_in_execution_order.swap(execution_order);
+	for (unsigned int i = 0; i < nodes_in_execution_order.size(); ++i)
+		nodes_in_execution_order[i]->order = i;
+}
+
+void LiteGraph::LGraph::clearFusedNodes()
+{
+	for (unsigned int i = 0; i < fused_nodes.size(); ++i)
+		detachPlanNode(fused_nodes[i]);
+	for (unsigned int i = 0; i < fused_nodes.size(); ++i)
+		delete fused_nodes[i];
+	fused_nodes.clear();
+}
+
+LiteGraph::LEventQueue::LEventQueue(int capacity)
+{
+	this->capacity = capacity;
+	items = new Item[capacity];
+	head = 0;
+	count = 0;
+	dropped = 0;
+	batch.reserve(capacity);
+}
+
+LiteGraph::LEventQueue::~LEventQueue()
+{
+	delete[] items;
+}
+
+bool LiteGraph::LEventQueue::push(LGraphNode* node, int slot, const LEvent& event, int depth)
+{
+	if (count == capacity || depth > node->graph->max_event_depth)
+	{
+		dropped++;
+		return false;
+	}
+	Item& item = items[(head + count) % capacity];
+	item.node = node;
+	item.slot = slot;
+	item.depth = depth;
+	item.event = event;
+	count++;
+	return true;
+}
+
+//groups the execution order in levels of nodes that only depend on previous levels
+//inside a level the thread safe nodes go first, nodes with feedback inputs are serialized to avoid reading data while it is written
+void LiteGraph::LGraph::buildExecutionLevels()
+{
+	int num = (int)nodes_in_execution_order.size();
+	std::vector<int> node_level(num, 0);
+	std::vector<bool> serial(num, false);
+	int num_levels = 0;
+	for (int i = 0; i < num; ++i)
+	{
+		LGraphNode* node = nodes_in_execution_order[i];
+		int level = 0;
+		serial[i] = !(node->flags & NODE_THREAD_SAFE);
+		for (unsigned int j = 0; j < node->inputs.size(); ++j)
+		{
+			LSlot* slot = node->inputs[j];
+			if (!slot->origin || slot->origin->node->order < 0) //origin not executed by this plan
+				continue;
+			if (slot->origin->node->order >= i) //feedback, reads the previous step
+			{
+				serial[i] = true;
+				continue;
+			}
+			int origin_level = node_level[slot->origin->node->order] + 1;
+			if (origin_level > level)
+				level = origin_level;
+		}
+		node_level[i] = level;
+		if (level + 1 > num_levels)
+			num_levels = level + 1;
+	}
+
+	//counting sort by level, parallel nodes before serial ones
+	execution_levels.assign(num_levels, LExecutionLevel());
+	std::vector<int> num_parallel(num_levels, 0);
+	std::vector<int> num_nodes(num_levels, 0);
+	for (int i = 0; i < num; ++i)
+	{
+		num_nodes[node_level[i]]++;
+		if (!serial[i])
+			num_parallel[node_level[i]]++;
+	}
+	std::vector<int> next_parallel(num_levels);
+	std::vector<int> next_serial(num_levels);
+	int start = 0;
+	for (int i = 0; i < num_levels; ++i)
+	{
+		LExecutionLevel& level = execution_levels[i];
+		level.start = start;
+		level.parallel_end = start + num_parallel[i];
+		level.end = start + num_nodes[i];
+		next_parallel[i] = level.start;
+		next_serial[i] = level.parallel_end;
+		start = level.end;
+	}
+	std::vector<LGraphNode*> sorted(num);
+	for (int i = 0; i < num; ++i)
+	{
+		int level = node_level[i];
+		sorted[serial[i] ? next_serial[level]++ : next_parallel[level]++] = nodes_in_execution_order[i];
+	}
+	nodes_in_execution_order.swap(sorted);
+	for (int i = 0; i < num; ++i)
+		nodes_in_execution_order[i]->order = i;
+}
+
+//the thread safe nodes of a level dont depend on each other, so they are sorted by batch kernel to make them consecutive
+void LiteGraph::LGraph::groupBatchKernels()
+{
+	int num = (int)nodes_in_execution_order.size();
+	batch_ends.resize(num);
+	for (unsigned int i = 0; i < execution_levels.size(); ++i)
+	{
+		LExecutionLevel& level = execution_levels[i];
+		std::stable_sort(nodes_in_execution_order.begin() + level.start, nodes_in_execution_order.begin() + level.parallel_end, [](LGraphNode* a, LGraphNode* b) {
+			return (uintptr_t)a->getBatchKernel() < (uintptr_t)b->getBatchKernel();
+		});
+
+		//serial nodes keep their order and are executed one by one
+		for (int j = level.parallel_end; j < level.end; ++j)
+			batch_ends[j] = j + 1;
+		for (int j = level.parallel_end - 1; j >= level.start; --j)
+		{
+			BatchKernel kernel = nodes_in_execution_order[j]->getBatchKernel();
+			bool same = kernel && j + 1 < level.parallel_end && nodes_in_execution_order[j + 1]->getBatchKernel() == kernel;
+			batch_ends[j] = same ? batch_ends[j + 1] : j + 1;
+		}
+	}
+	for (int i = 0; i < num; ++i)
+		nodes_in_execution_order[i]->order = i;
+}
+
+static inline bool isScalarType(LiteGraph::DataType type)
+{
+	return type == LiteGraph::DataType::NUMBER || type == LiteGraph::DataType::BOOL;
+}
+
+//the scalar outputs of the plan are moved to one array in execution order, so a step reads and writes them
+//mostly sequentially instead of from wherever they were allocated. Their targets are updated through LSlot::targets
+void LiteGraph::LGraph::packWires()
+{
+	num_wires = 0;
+	for (unsigned int i = 0; i < nodes_in_execution_order.size(); ++i)
+		for (unsigned int j = 0; j < nodes_in_execution_order[i]->outputs.size(); ++j)
+			if (isScalarType(nodes_in_execution_order[i]->outputs[j]->type))
+				num_wires++;
+	if (!num_wires)
+		return;
+
+	wire_data = new LData[num_wires];
+	packed_slots.reserve(num_wires);
+	unpacked_data.reserve(num_wires);
+	for (unsigned int i = 0; i < nodes_in_execution_order.size(); ++i)
+	{
+		LGraphNode* node = nodes_in_execution_order[i];
+		for (unsigned int j = 0; j < node->outputs.size(); ++j)
+		{
+			LSlot* slot = node->outputs[j];
+			if (!isScalarType(slot->type))
+				continue;
+			slot->wire = (int)packed_slots.size();
+			LData* data = &wire_data[slot->wire];
+			*data = *slot->data;
+			data->stamp = slot->data->stamp;
+			packed_slots.push_back(slot);
+			unpacked_data.push_back(slot->data);
+			slot->data = data;
+			for (unsigned int k = 0; k < slot->targets.size(); ++k)
+				slot->targets[k]->origin_data = data;
+		}
+	}
+}
+
+void LiteGraph::LGraph::unpackWires()
+{
+	for (unsigned int i = 0; i < packed_slots.size(); ++i)
+	{
+		LSlot* slot = packed_slots[i];
+		LData* data = unpacked_data[i];
+		*data = *slot->data;
+		data->stamp = slot->data->stamp;
+		slot->data = data;
+		slot->wire = -1;
+		for (unsigned int k = 0; k < slot->targets.size(); ++k)
+			slot->targets[k]->origin_data = data;
+	}
+	//the published outputs can point to a wire too
+	for (auto it = outputs.begin(); it != outputs.end() && wire_data; ++it)
+		if (it->second >= wire_data && it->second < wire_data + num_wires)
+			it->second = unpacked_data[it->second - wire_data];
+	packed_slots.clear();
+	unpacked_data.clear();
+	delete[] wire_data;
+	wire_data = NULL;
+	num_wires = 0;
 }
 
 void LiteGraph::LGraph::setOutput( std::string name, LiteGraph::LData* data )
@@ -767,6 +1759,16 @@ void LiteGraph::LGraph::setOutput( std::string name, LiteGraph::LData* data )
 	outputs[name] = data;
 }
 
+LiteGraph::LData* LiteGraph::LGraph::getInput(const std::string& name)
+{
+	auto it = inputs.find(name);
+	if (it != inputs.end())
+		return it->second;
+	LData* data = new LData();
+	inputs[name] = data;
+	return data;
+}
+
 bool LiteGraph::LGraph::configure( std::string data )
 {
 	cJSON *json = cJSON_Parse(data.c_str());
@@ -775,6 +1777,13 @@ bool LiteGraph::LGraph::configure( std::string data )
 		std::cerr << "error in JSON file" << std::endl;
 		return false;
 	}
+	return configureFromJSON(json);
+}
+
+bool LiteGraph::LGraph::configureFromJSON( JSON json_object )
+{
+	cJSON *json = (cJSON *)json_object;
+	LArenaScope arena_scope(arena); //the subgraphs without arena go to the heap
 
 	cJSON* num_json = cJSON_GetObjectItemCaseSensitive( json, "last_node_id");
 	if (cJSON_IsNumber(num_json))
@@ -866,9 +1875,6 @@ bool LiteGraph::LGraph::configure( std::string data )
 		add(node);
 	}
 
-	//in case they are not stored in execution order
-	sortByExecutionOrder();
-
 	if (LiteGraph::verbose)
 		std::cout << "Links *****************" << std::endl;
 	
@@ -911,6 +1917,9 @@ bool LiteGraph::LGraph::configure( std::string data )
 		target_slot->link = link;
 	}
 
+	//in case they are not stored in execution order
+	buildExecutionPlan();
+
 	if (LiteGraph::verbose)
 		std::cout << "***********************" << std::endl;
 		
@@ -1179,6 +2188,8 @@ LiteGraph::DataType LiteGraph::stringToType(const char* str)
 		return DataType::POINTER;
 	if (s == "EVENT")
 		return DataType::EVENT;
+	if (s == "BUFFER")
+		return DataType::BUFFER;
 	if (s == "" || s == "*")
 		return DataType::ANY;
 
@@ -1201,13 +2212,40 @@ const char* LiteGraph::typeToString(LiteGraph::DataType type)
 	case DataType::JSON_OBJECT:	return "JSON_OBJECT";
 	case DataType::POINTER:		return "POINTER";
 	case DataType::EVENT:		return "EVENT";
+	case DataType::BUFFER:		return "BUFFER";
 	case DataType::ANY:			return "*";
 	default: return "*";
 	}
 }
 
+//the names are never removed so the pointers returned stay valid
+static std::mutex event_types_mutex;
+static std::unordered_map<std::string, int> event_type_ids = { { "", 0 } };
+static std::deque<std::string> event_type_names = { "" };
+
+int LiteGraph::internEventType(const char* name)
+{
+	std::lock_guard<std::mutex> lock(event_types_mutex);
+	auto it = event_type_ids.find(name);
+	if (it != event_type_ids.end())
+		return it->second;
+	int id = (int)event_type_names.size();
+	event_type_names.push_back(name);
+	event_type_ids[name] = id;
+	return id;
+}
+
+const char* LiteGraph::getEventTypeName(int type_id)
+{
+	std::lock_guard<std::mutex> lock(event_types_mutex);
+	if (type_id < 0 || type_id >= (int)event_type_names.size())
+		return "";
+	return event_type_names[type_id].c_str();
+}
+
 void LiteGraph::init()
 {
 	//register base nodes in the system
 	initBaseNodes();
+	initBufferNodes();
 }
\ No newline at end of file
@@ -2,8 +2,21 @@
 
 #include <vector>
 #include <string>
+#include <string_view>
 #include <map>
 #include <iostream>
+#include <cstring>
+#include <cstdint>
+#include <cstdio>
+#include <atomic>
+#include <cassert>
+
+#ifndef _MSC_VER //secure CRT functions are only available in MSVC
+	#define strcpy_s(dst, size, src) (strncpy(dst, src, size), (dst)[(size) - 1] = 0)
+	#define _TRUNCATE ((size_t)-1)
+	#define strncpy_s(dst, size, src, count) (strncpy(dst, src, (size) - 1), (dst)[(size) - 1] = 0) //only with _TRUNCATE
+	#define sscanf_s sscanf
+#endif
 
 namespace LiteGraph {
 
@@ -22,9 +35,23 @@ namespace LiteGraph {
 	class LLink;
 	class LGraph;
 	class LGraphNode;
+	class LThreadPool;
+	class LInjectionQueue;
+	class LCompiler;
+	class LFusedNode;
+	class LConversionNode;
+	class LArena;
+	class LPort;
 
 	typedef void* JSON;
 
+	//objects created in the current LArena (if any), see arena.h
+	void* arenaNew(size_t size);
+	void arenaDelete(void* ptr);
+	#define LARENA_ALLOCATED \
+		static void* operator new(size_t size) { return LiteGraph::arenaNew(size); } \
+		static void operator delete(void* ptr) { LiteGraph::arenaDelete(ptr); }
+
 	extern std::map<std::string, LGraphNode*> node_types;
 	void registerNodeType(LGraphNode* node);
 	LGraphNode* createNode(const char* name);
@@ -46,14 +73,39 @@ namespace LiteGraph {
 		OBJECT,		//generic object that must be stored inside WARNING: CANNOT CONTAIN POINTERS or VIRTUAL METHODS
 		POINTER,	//pointer to something outside, it only stores the address
 		EVENT,		//LEvent
+		BUFFER,		//typed array of numbers (BufferType), contiguous and aligned for SIMD
 		JSON_OBJECT,//TODO
 		ANY
 	};
 
+	//type of the values in a DataType::BUFFER
+	enum BufferType {
+		BUFFER_FLOAT32,
+		BUFFER_FLOAT64,
+		BUFFER_INT32
+	};
+
+	static int getBufferTypeSize(BufferType type) { return type == BUFFER_FLOAT64 ? 8 : 4; }
+	static BufferType toBufferType(const float& v) { return BUFFER_FLOAT32; }
+	static BufferType toBufferType(const double& v) { return BUFFER_FLOAT64; }
+	static BufferType toBufferType(const int& v) { return BUFFER_INT32; }
+
+	//non owning view of contiguous values, like std::span (C++20)
+	template<class T> struct LSpan {
+		const T* data;
+		int size;
+		LSpan() { data = NULL; size = 0; }
+		LSpan(const T* data, int size) { this->data = data; this->size = size; }
+		const T* begin() const { return data; }
+		const T* end() const { return data + size; }
+		const T& operator[](int index) const { return data[index]; }
+		bool empty() const { return size == 0; }
+	};
+
 	vec3 hex2rgb(std::string hex);
 	std::string rgb2hex(vec3 color);
 
-	static std::string datatypes[] = { "NONE", "CUSTOM", "ENUM", "STRING", "BOOL", "VEC2", "VEC3", "VEC4", "QUAT", "MAT3", "MAT4", "ARRAY", "OBJECT", "POINTER", "EVENT", "JSON_OBJECT", "ANY" };
+	static std::string datatypes[] = { "NONE", "CUSTOM", "ENUM", "STRING", "BOOL", "VEC2", "VEC3", "VEC4", "QUAT", "MAT3", "MAT4", "ARRAY", "OBJECT", "POINTER", "EVENT", "BUFFER", "JSON_OBJECT", "ANY" };
 	
 	static DataType dataToType(const bool& v) { return DataType::BOOL; }
 	static DataType dataToType(const float& v) { return DataType::NUMBER; }
@@ -72,30 +124,66 @@ namespace LiteGraph {
 	template<class T> static DataType dataToType(const T& v) { return DataType::OBJECT; }
 	template<class T> static DataType dataToType(const T* v) { return DataType::POINTER; }
 
-	#define LEVENT_SIZE 255
+	//event types are interned, every name gets an id so events are compared by id (thread safe, 0 is the empty type)
+	int internEventType(const char* name);
+	const char* getEventTypeName(int type_id);
+
+	#define LEVENT_SIZE 24 //string payload, including the '\0', longer strings are truncated to 23 characters
 
-	//used when triggering events
+	//used when triggering events, 40 bytes so it is copied without allocations or string copies
 	class LEvent {
 	public:
-		char type[LEVENT_SIZE];
-		char data[LEVENT_SIZE];
+		enum PayloadType { NO_PAYLOAD, NUMBER_PAYLOAD, STRING_PAYLOAD, DATA_PAYLOAD };
+
+		int type_id;
+		PayloadType payload;
+		union {
+			double number;
+			char string[LEVENT_SIZE];
+			LData* data; //not owned, must be alive while the event is dispatched
+		};
 		float num; //may be useful
-		LEvent() { type[0] = 0; data[0] = 0; num = 0; }
-		LEvent(const char* type) { setType(type);  data[0] = 0; num = 0; }
+
+		LEvent() { type_id = 0; payload = NO_PAYLOAD; number = 0; num = 0; }
+		LEvent(int type_id) { this->type_id = type_id; payload = NO_PAYLOAD; number = 0; num = 0; }
+		LEvent(const char* type) { setType(type); payload = NO_PAYLOAD; number = 0; num = 0; }
 		LEvent(const char* type, const char* data) { setType(type); setData(data); num = 0; }
-		void setType(const char* type) { strcpy_s(this->type, LEVENT_SIZE, type); }
-		void setData(const char* data) { strcpy_s(this->data, LEVENT_SIZE, data); }
-		void operator = (const LEvent& e) { setType(e.type); setData(e.data); num = e.num; }
+		void setType(const char* type) { type_id = internEventType(type); }
+		void setData(const char* data) { payload = STRING_PAYLOAD; strncpy_s(string, LEVENT_SIZE, data, _TRUNCATE); } //strcpy_s aborts if it doesnt fit
+		void setData(double number) { payload = NUMBER_PAYLOAD; this->number = number; }
+		void setData(LData* data) { payload = DATA_PAYLOAD; this->data = data; }
+		const char* getType() const { return getEventTypeName(type_id); }
+		const char* getData() const { return payload == STRING_PAYLOAD ? string : ""; }
+		bool is(int type_id) const { return this->type_id == type_id; }
 	};
 
 	void registerCustomDataType(const char* name, int id);
 	DataType stringToType(const char* str);
 	const char* typeToString(DataType type);
 
-	//total, 32 bytes per data (variable in case of dynamic content)
+	#define LDATA_INLINE_SIZE 64 //payloads up to this size (mat3, mat4, short strings) are stored inside the LData
+
+	//payload of an LData that doesnt fit inline, copies of the LData share it until one of them writes (copy on write)
+	//the content is aligned to 32 bytes (AVX)
+	struct alignas(32) LDataBuffer {
+		std::atomic<int> refs;
+		int capacity;
+		int num_items;	//LData constructed inside, for arrays
+		void* allocation; //where the header is placed, aligned
+
+		static LDataBuffer* create(int capacity);
+		uint8_t* getData() { return (uint8_t*)(this + 1); }
+		bool isShared() { return refs.load(std::memory_order_acquire) > 1; }
+		void retain() { refs.fetch_add(1, std::memory_order_relaxed); }
+		void release(); //deleted with the last reference
+	};
+
+	//total, 96 bytes per data (variable in case of dynamic content)
 	class LData {
 	public:
+		LARENA_ALLOCATED
 		DataType type;
+		unsigned int stamp; //increased every time assign changes the content, used to detect changes
 
 		//generic types (this ones cannot have pointers inside and must be lightweight)
 		union {
@@ -107,25 +195,29 @@ namespace LiteGraph {
 			vec4 vector4;
 			quat quaternion;
 			void* pointer; //to store generic stuff
+			uint8_t local[LDATA_INLINE_SIZE]; //small payloads, custom_data points here
+			struct { BufferType type; int length; } buffer; //DataType::BUFFER, the values are in custom_data
 		};
 
 		//used to store large objects or objects with variable size
-		int bytes; //allocated bytes
-		void* custom_data; //generic pointer
+		int bytes; //used bytes
+		void* custom_data; //generic pointer, to local or to the heap buffer
 
 		LData();
+		LData(const LData& v); //shares the payload, same as operator =
 		~LData();
 		void clear();
 		void setType(DataType type);
 
-		void assign(int v) { setType(DataType::NUMBER); number = v; }
-		void assign(float v) { setType(DataType::NUMBER); number = v; }
-		void assign(double v) { setType(DataType::NUMBER); number = v; }
-		void assign(vec2 v) { setType(DataType::VEC2); vector2 = v; }
-		void assign(vec3 v) { setType(DataType::VEC3); vector3 = v; }
-		void assign(vec4 v) { setType(DataType::VEC4); vector4 = v; }
+		void assign(bool v) { if (type == DataType::BOOL && boolean == v) return; setType(DataType::BOOL); boolean = v; ++stamp; }
+		void assign(int v) { assign((double)v); }
+		void assign(float v) { assign((double)v); }
+		void assign(double v) { if (type == DataType::NUMBER && number == v) return; setType(DataType::NUMBER); number = v; ++stamp; }
+		void assign(vec2 v) { if (type == DataType::VEC2 && !memcmp(&vector2, &v, sizeof(v))) return; setType(DataType::VEC2); vector2 = v; ++stamp; }
+		void assign(vec3 v) { if (type == DataType::VEC3 && !memcmp(&vector3, &v, sizeof(v))) return; setType(DataType::VEC3); vector3 = v; ++stamp; }
+		void assign(vec4 v) { if (type == DataType::VEC4 && !memcmp(&vector4, &v, sizeof(v))) return; setType(DataType::VEC4); vector4 = v; ++stamp; }
 		//void assign(quat v) { setType(DataType::QUAT); quaternion = v; } //same as vec4 so no need
-		void assign(void* pointer) { setType(DataType::POINTER); this->pointer = pointer; }
+		void assign(void* pointer) { if (type == DataType::POINTER && this->pointer == pointer) return; setType(DataType::POINTER); this->pointer = pointer; ++stamp; }
 		
 		void assign(std::vector<float>& v) { assign(&v[0], sizeof(float) * v.size()); }
 
@@ -141,12 +233,28 @@ namespace LiteGraph {
 
 		void assign(const std::vector<LData*>& v);
 
-		LEvent getEvent();
-		std::string getString();
-		std::vector<LData*> getArray(); //array of generic data
+		LEvent getEvent() const;
+		std::string getString() const;
+		std::string_view getStringView() const; //no copy, valid until the data changes, empty if it is not a string
+		std::vector<const LData*> getArray() const; //array of generic data, the items are shared with the copies so they are read only
+		int getArrayLength() const { return type == DataType::ARRAY ? bytes / (int)sizeof(LData) : 0; }
+		const LData* getArrayItem(int index) const { return (const LData*)custom_data + index; }
+		LSpan<LData> getArrayView() const { return LSpan<LData>((const LData*)custom_data, getArrayLength()); }
 		std::vector<float> getArrayOfFloat();
 		void* const getPointer(); //for safe accessing the data
-		void* getObject();
+		const void* getObject() const; //it may be shared with other data, use editObject to modify it
+		void* editObject(); //clones the object if it is shared, call it before modifying it in place
+
+		//DataType::BUFFER, the values are always in the heap buffer so they are aligned and shared by the copies
+		void assignBuffer(BufferType type, const void* values, int length);
+		void* editBuffer(BufferType type, int length); //storage to write length values, the previous content is lost
+		const void* getBuffer(BufferType& type, int& length); //NULL if it is not a buffer
+		template<class T> LSpan<T> getBufferView() //empty if it is not a buffer of T
+		{
+			if (type != DataType::BUFFER || !custom_data || buffer.type != toBufferType(T()))
+				return LSpan<T>();
+			return LSpan<T>((const T*)custom_data, buffer.length);
+		}
 		template<class T> T getObject(const T& v) //Used with custom types
 		{
 			T obj;
@@ -160,44 +268,72 @@ namespace LiteGraph {
 		void operator = (const float& v) { assign(v); }
 		void operator = (const std::string & v) { assign(v); }
 		void operator = (const LEvent& v) { assign(v); }
+
+	private:
+		LDataBuffer* heap; //kept when the type or the size changes if nobody else holds it, so it can be reused
+
+		void reserve(int size, bool allow_inline = true); //points custom_data to at least size writable bytes, only allocates if it doesnt fit or it is shared
+		void release(); //empties the payload, keeps the heap buffer if it is not shared
 	};
 
 	class LLink {
 	public:
+		LARENA_ALLOCATED
 		int id;
 		int origin_id;
 		int origin_slot;
 		int target_id;
 		int target_slot;
+		bool feedback;	//closes a cycle, the target reads the value from the previous step
 
 		LLink(int id, int origin_id, int origin_slot, int target_id, int target_slot);
 	};
 
 	class LSlot {
 	public:
+		LARENA_ALLOCATED
 		std::string name;	//slot name can beused by some nodes during execution to define data to send (specially in variable slots nodes)
 		DataType type;		//expected data type for this slot, could be DataType::ANY if several are supported
+		DataType resolved_type; //set by the execution plan, for ANY slots the type of its links if they agree
 		int custom_type;	//used by some nodes to precompute comparisons based on slot name (to optimize execution)
 		LData* data;		//pointer to the slot data
 		LGraphNode* node;	//parent node
 
 		LLink* link;		//for input slots (one single connection allowed)
 		std::vector<LLink*> links; //for output slots (multiple connections allowed)
+		unsigned int stamp;	//for input slots, stamp of the origin data the last time the node was executed
+		int wire;			//for output slots, index in LGraph::wire_data when the plan packs it, -1 otherwise
+		std::string number_text; //for input slots, number formatted by getInputDataAsStringView, only formatted again when it changes
+		double number_text_value;
+		bool has_number_text;
+
+		//resolved by the execution plan for input slots, so reading the input doesnt need to search nodes by id
+		LSlot* origin;		//output slot this input is linked to
+		LData* origin_data;	//data of the origin slot
+		std::vector<LSlot*> targets; //for output slots, input slots linked to it
 
 		LSlot(LGraphNode* node, const char* name, DataType type)
 		{
 			this->type = type;
+			resolved_type = type;
 			this->name = name;
 			data = NULL;
 			link = NULL;
 			this->node = node;
 			custom_type = -1;
+			origin = NULL;
+			origin_data = NULL;
+			stamp = 0;
+			wire = -1;
+			number_text_value = 0;
+			has_number_text = false;
 		}
 
 		~LSlot();
 
 		bool isConnected() { return link != NULL || links.size(); }
-		LData* getOriginData();
+		LData* getOriginData() { return origin_data; }
+		void resolveOrigin(); //updates origin and origin_data from the link
 	};
 
 	#define REGISTERNODE(NODE_NAME,NODE_CLASS) \
@@ -208,13 +344,29 @@ namespace LiteGraph {
 
 	#define CTOR_NODE() 	if (mustRegister())	LiteGraph::registerNodeType(this);
 
+	//LGraphNode::flags, set by the node in its constructor
+	enum NodeFlags {
+		NODE_THREAD_SAFE = 1 << 0,	//onExecute only reads its inputs and writes its outputs (no events, no shared state), can run in parallel
+		NODE_ALWAYS_RUN = 1 << 1,	//output depends on something else than its inputs (time, external state), never skipped in incremental mode
+		NODE_LANES = 1 << 2,		//implements onExecuteLanes for LGraphBatch
+		NODE_PURE = 1 << 3,			//outputs depend only on the inputs and the properties (no events, no side effects), can be folded
+		NODE_NO_SIDE_EFFECTS = 1 << 4,	//only writes its outputs (implied by NODE_PURE), removed from the plan if nobody reads them
+		NODE_FUSABLE = 1 << 5,			//implements onFuse
+		NODE_HOST_TYPED = 1 << 6		//the slots carry whatever the host assigns (graph inputs and outputs), their type is only a default and the plan doesnt check it
+	};
+
+	//executes several nodes of the same type, in order, instead of calling onExecute on each one
+	typedef void (*BatchKernel)(LGraphNode* const* nodes, int count);
+
 	class LGraphNode {
 	public:
+		LARENA_ALLOCATED
 		int id;
-		int flags;
+		int flags; //NodeFlags
+		bool dirty; //must execute even if its inputs didnt change (incremental mode)
 
 		LGraph* graph;
-		int order;
+		int order; //position in the execution order (the one in the JSON is only a hint)
 
 		vec2 position;
 		vec2 size;
@@ -222,6 +374,7 @@ namespace LiteGraph {
 
 		std::vector<LSlot*> inputs;
 		std::vector<LSlot*> outputs;
+		std::vector<LPort*> ports; //LInput and LOutput members of the node
 
 		void* custom_data;
 
@@ -229,6 +382,9 @@ namespace LiteGraph {
 		virtual ~LGraphNode();
 		virtual void onExecute() {};
 
+		//batched execution (see LGraphBatch), every input and output is an array with the value of that slot for every instance
+		virtual void onExecuteLanes(const double* const* inputs, double* const* outputs, int num_lanes) {};
+
 		LSlot* addInput(const char* name, DataType type);
 		LSlot* addOutput(const char* name, DataType type);
 
@@ -241,6 +397,8 @@ namespace LiteGraph {
 		LGraphNode* getInputNode(int slot_index);
 		std::vector<LGraphNode*> getOutputNodes(int slot_index);
 
+		bool checkInputChanges(); //true if dirty or some input data changed since the last call
+
 		bool isInputConnected(int index);
 		bool isOutputConnected(int index);
 
@@ -252,6 +410,14 @@ namespace LiteGraph {
 		bool getInputDataAsBoolean(int slot);
 		double getInputDataAsNumber(int slot);
 		std::string getInputDataAsString(int slot);
+		std::string_view getInputDataAsStringView(int slot); //no allocations, valid until the input changes
+		template<class T> LSpan<T> getInputDataAsBuffer(int slot) //empty if it is not a buffer of T
+		{
+			LSlot* input = getInputSlot(slot);
+			if (!input || !input->getOriginData())
+				return LSpan<T>();
+			return input->getOriginData()->getBufferView<T>();
+		}
 		JSON getInputDataAsJSON(int slot);
 
 		//allows to send data directly without specifying the type manually
@@ -260,11 +426,9 @@ namespace LiteGraph {
 			if (!slot)
 				return;
 			LData* data = slot->data;
-			if (data == NULL || (slot->type != dataToType(v) && slot->type != DataType::ANY))
-			{
-				std::cout << "output data dont match: " << slot->type << " expected " << datatypes[dataToType(v)] << std::endl;
+			if (data == NULL)
 				return;
-			}
+			assert((slot->resolved_type == dataToType(v) || slot->resolved_type == DataType::ANY) && "output type doesnt match, slot types are checked when the plan is built");
 			data->assign(v);
 		}
 
@@ -288,9 +452,172 @@ namespace LiteGraph {
 
 		virtual void onConfigure(void* json) {}
 
+		//called at the end of buildExecutionPlan for the nodes in the plan, the origins of the inputs dont change until the next build
+		virtual void onPlanBuilt() {}
+
+		//OPTIMIZE_INLINE_SUBGRAPHS: append to the execution order the nodes that replace this one, false to keep it
+		virtual bool onInline(std::vector<LGraphNode*>& execution_order) { return false; }
+
+		//OPTIMIZE_MERGE_DUPLICATES: append everything that affects the outputs besides the inputs (properties), false if it cannot be merged
+		virtual bool getSignature(std::string& signature) { return false; }
+
+		//OPTIMIZE_BATCH_KERNELS: static function that executes all the instances of this type in a level (never in incremental mode)
+		virtual BatchKernel getBatchKernel() { return NULL; }
+
+		//OPTIMIZE_FUSION: express onExecute with the ops of the fused node, reading the inputs with LFusedNode::input
+		virtual bool onFuse(LFusedNode* fused) { return false; }
+
+		//LCompiler: emit the code of onExecute (and of onAction for the events received), false if not supported
+		virtual bool onCompile(LCompiler* compiler) { return false; }
+		virtual bool onCompileAction(LCompiler* compiler, int slot, const std::string& event) { return false; }
+
 		void removeSlots();
 	};
 
+	//typed ports, declared as members of the node instead of calling addInput/addOutput and getInputDataAs.../setOutputData by index:
+	//	LInput<double> A; LOutput<bool> out;
+	//	MyNode::MyNode() : A(this, "A"), out(this, "out") { CTOR_NODE(); }
+	//	void MyNode::onExecute() { out.set(A.get() > 0.5); }
+	//the slots are created in the order of the members, and the plan binds the ports to the data of the slots (LGraph::bindPorts),
+	//so reading is a type check and a load, and writing a compare and a store. Only the types stored directly in LData can be used (LPortType)
+	template<class T> struct LPortType; //not defined for the rest, so they dont compile
+	template<> struct LPortType<double> {
+		static const DataType type = DataType::NUMBER;
+		static double* get(LData* data) { return &data->number; }
+	};
+	template<> struct LPortType<bool> {
+		static const DataType type = DataType::BOOL;
+		static bool* get(LData* data) { return &data->boolean; }
+	};
+
+	class LPort {
+	public:
+		LGraphNode* node;
+		int index; //slot index
+
+		LPort(LGraphNode* node, int index) { this->node = node; this->index = index; node->ports.push_back(this); }
+		LPort(const LPort&) = delete; //bound to the slots of its node
+		LPort& operator=(const LPort&) = delete;
+		virtual void bind() = 0;
+	};
+
+	template<class T> class LInput : public LPort {
+	public:
+		LInput(LGraphNode* node, const char* name) : LPort(node, (int)node->inputs.size())
+		{
+			value = T();
+			value_type = LPortType<T>::type;
+			tag = &value_type;
+			ptr = &value;
+			node->addInput(name, LPortType<T>::type);
+		}
+
+		//the type of the origin is checked every read, like getInputDataAs... it is 0 or false if it doesnt match
+		T get() const { return *tag == LPortType<T>::type ? *ptr : T(); }
+
+		//the origin data is not modified, it can be empty until its node runs
+		void bind()
+		{
+			LSlot* slot = index < (int)node->inputs.size() ? node->inputs[index] : NULL;
+			LData* data = slot ? slot->origin_data : NULL;
+			tag = data ? &data->type : &value_type;
+			ptr = data ? LPortType<T>::get(data) : &value;
+		}
+
+	private:
+		const DataType* tag; //type of the data read
+		const T* ptr;
+		DataType value_type;
+		T value; //read when the input is not connected
+	};
+
+	template<class T> class LOutput : public LPort {
+	public:
+		LOutput(LGraphNode* node, const char* name) : LPort(node, (int)node->outputs.size())
+		{
+			value = T();
+			unbound_stamp = 0;
+			ptr = &value;
+			stamp = &unbound_stamp;
+			node->addOutput(name, LPortType<T>::type);
+		}
+
+		//same as LData::assign, the stamp only changes if the value does
+		void set(T v)
+		{
+			if (*ptr == v)
+				return;
+			*ptr = v;
+			++*stamp;
+		}
+
+		void bind()
+		{
+			ptr = &value;
+			stamp = &unbound_stamp;
+			if (index >= (int)node->outputs.size())
+				return;
+			LData* data = node->outputs[index]->data;
+			if (data->type != LPortType<T>::type)
+			{
+				data->setType(LPortType<T>::type); //without changing the stamp, the nodes run anyway after a new plan
+				*LPortType<T>::get(data) = T();
+			}
+			ptr = LPortType<T>::get(data);
+			stamp = &data->stamp;
+		}
+
+	private:
+		T* ptr;
+		unsigned int* stamp;
+		T value; //until it is bound, or if the slot doesnt exist
+		unsigned int unbound_stamp;
+	};
+
+	//preallocated ring buffer of pending onAction calls, used by trigger when the graph has an event queue
+	class LEventQueue {
+	public:
+		struct Item {
+			LGraphNode* node;
+			int slot;
+			int depth; //0 if triggered from onExecute, +1 for every onAction in the chain
+			LEvent event;
+		};
+
+		Item* items;
+		int capacity;
+		int head;
+		int count;
+		unsigned int dropped; //events lost because the queue was full or too deep
+
+		LEventQueue(int capacity);
+		~LEventQueue();
+
+		bool push(LGraphNode* node, int slot, const LEvent& event, int depth);
+		Item& get(int index) { return items[(head + index) % capacity]; }
+		void pop(int num) { head = (head + num) % capacity; count -= num; }
+
+		std::vector<int> batch; //scratch to sort the batch by target
+	};
+
+	//LGraph::optimizations, passes applied when the execution plan is built
+	enum PlanOptimizations {
+		OPTIMIZE_INLINE_SUBGRAPHS = 1 << 0,	//nodes of subgraphs are executed directly in the parent plan
+		OPTIMIZE_CONSTANT_FOLDING = 1 << 1,	//pure nodes that only depend on constants are executed once when the plan is built
+		OPTIMIZE_DEAD_NODES = 1 << 2,		//nodes without side effects whose outputs dont reach any other node are not executed
+		OPTIMIZE_MERGE_DUPLICATES = 1 << 3,	//pure nodes with the same type, signature and inputs are executed once
+		OPTIMIZE_FUSION = 1 << 4,			//consecutive fusable nodes are replaced by a single LFusedNode
+		OPTIMIZE_BATCH_KERNELS = 1 << 5,	//thread safe nodes of the same type in a level are executed with their batch kernel
+		OPTIMIZE_PACKED_WIRES = 1 << 6		//the LData of NUMBER and BOOL outputs are placed in one array in execution order, instead of one heap allocation each
+	};
+
+	//range of nodes_in_execution_order that dont depend on each other
+	struct LExecutionLevel {
+		int start;
+		int parallel_end;	//[start,parallel_end) are thread safe, the rest are executed serially
+		int end;
+	};
+
 	class LGraph {
 	public:
 
@@ -300,7 +627,34 @@ namespace LiteGraph {
 		std::map<int, LLink*> links_by_id;
 
 		std::vector<LGraphNode*> nodes_in_execution_order;
-
+		std::vector<LExecutionLevel> execution_levels;
+		std::vector<int> batch_ends; //OPTIMIZE_BATCH_KERNELS, for every node the end of the nodes that share its batch kernel
+		LData* wire_data;	//OPTIMIZE_PACKED_WIRES, replaces the data of the scalar outputs while the plan is valid
+		int num_wires;
+		std::vector<LSlot*> packed_slots;	//indexed by wire
+		std::vector<LData*> unpacked_data;	//their own data, restored when the plan is rebuilt
+
+		LArena* arena; //owned, if set the objects created by configure go there and clear resets it
+		std::vector<LGraph*> inlined_graphs; //subgraphs whose nodes are in our execution order
+		std::vector<LFusedNode*> fused_nodes; //owned, in our execution order instead of the nodes they replace
+		std::vector<LConversionNode*> conversion_nodes; //owned, in our execution order before the nodes that read them
+		std::vector<std::string> type_errors; //links that cannot be converted, found by the last plan
+
+		int optimizations; //PlanOptimizations
+
+		LThreadPool* thread_pool;	//not owned, if set levels with enough thread safe nodes run in parallel
+		int parallel_min_nodes;		//below this amount of thread safe nodes a level is executed serially
+		int parallel_grain;			//minimum nodes per task
+		bool incremental;			//skip nodes whose inputs didnt change since their last execution (unless NODE_ALWAYS_RUN)
+
+		LEventQueue* event_queue;	//if set, trigger enqueues the events and they are dispatched after the nodes execution
+		int max_event_depth;		//events triggered deeper than this in a chain are dropped
+		int max_events_per_step;	//the rest wait for the next step
+		int event_depth;			//depth of the event being dispatched
+
+		LInjectionQueue* injection_queue; //events and inputs posted from other threads, consumed at the beginning of runStep
+
+		std::map<std::string, LData*> inputs; //owned, set by the host (or injected) and read by the nodes
 		std::map<std::string, LData*> outputs;
 
 		int id; //could be helpful, not used for anything
@@ -308,6 +662,7 @@ namespace LiteGraph {
 		int last_link_id;
 
 		bool has_errors;
+		bool plan_dirty; //topology changed since the execution plan was built
 
 		double time; //in seconds
 
@@ -323,11 +678,35 @@ namespace LiteGraph {
 		void runStep(float dt = 0);
 
 		virtual bool configure( std::string data );
+		virtual bool configureFromJSON( JSON json );
 		virtual std::string serialize(); //not very necessary right now
 
-		void sortByExecutionOrder();
+		void sortByExecutionOrder(); //topological sort of the links, cycles are broken with feedback links
+		void buildExecutionPlan(); //resolves slots and execution order, called automatically when the topology changes
+		void invalidateExecutionPlan() { plan_dirty = true; }
+		void inlineSubgraphs();
+		void resolveSlotTypes(); //reports the type errors once, instead of every time a value is written
+		void clearConversionNodes();
+		void bindPorts(); //must be called again every time the plan rewires the slots
+		void foldConstants(); //if a property of a folded node changes call invalidateExecutionPlan
+		void removeDeadNodes();
+		void mergeDuplicateNodes();
+		void fuseNodes();
+		void clearFusedNodes();
+		void buildExecutionLevels();
+		void groupBatchKernels();
+		void packWires();
+		void unpackWires();
 
 		void setOutput(std::string name, LData* data);
+		LData* getInput(const std::string& name); //creates it if it doesnt exist
+
+		void enableInjection(int capacity = 1024); //must be called before other threads start posting
+		void consumeInjected();
+
+		void enableArena(size_t block_size = 1 << 20); //call before configure
+		void enableEventQueue(int capacity = 1024); //0 to go back to synchronous events
+		void dispatchEvents();
 	};
 
 	std::string getFileContent(const std::string& path);
@@ -344,4 +723,5 @@ namespace LiteGraph {
 
 	void init();
 	void initBaseNodes();
+	void initBufferNodes();
 }
\ No newline at end of file
@@ -1,26 +1,223 @@
 #include "base.h"
 #include <iostream>
+#include <cmath>
 
 //used by nodes that support JSON objects
 #include "../libs/cJSON.h"
+#include "../compiler.h"
+#include "../fusion.h"
 
 
 using namespace LiteGraph;
 
+//used by the batch kernels, same conversions than getInputDataAs... without the slot lookups
+static inline double originNumber(LSlot* slot)
+{
+	LData* data = slot->origin_data;
+	return data && data->type == DataType::NUMBER ? data->number : 0;
+}
+
+static inline bool originBoolean(LSlot* slot)
+{
+	LData* data = slot->origin_data;
+	return data && data->type == DataType::BOOL ? data->boolean : false;
+}
+
 
 OutputNode::OutputNode()
 {
 	CTOR_NODE();
+	flags |= NODE_THREAD_SAFE | NODE_LANES | NODE_HOST_TYPED;
+	name = "output";
 
 	addInput("in", DataType::NUMBER);
 }
 
+//the origin data doesnt change until the plan is built again
+void OutputNode::onPlanBuilt()
+{
+	graph->setOutput(name, getInputData(0));
+}
+
+void OutputNode::onConfigure(void* json)
+{
+	JSON properties = getJSONObject(json, "properties");
+	if (!properties)
+		return;
+	readJSONString(properties, "name", name);
+}
+
+InputNode::InputNode()
+{
+	CTOR_NODE();
+	flags |= NODE_ALWAYS_RUN | NODE_NO_SIDE_EFFECTS | NODE_HOST_TYPED;
+	name = "input";
+	value = 0;
+	input = NULL;
+	input_stamp = 0;
+
+	addOutput("out", DataType::NUMBER);
+}
+
+void InputNode::onExecute()
+{
+	if (!input)
+	{
+		input = graph->getInput(name);
+		if (input->type == DataType::NONE)
+			input->assign(value);
+		input_stamp = input->stamp - 1;
+	}
+	if (input->stamp == input_stamp)
+		return;
+	input_stamp = input->stamp;
+	*outputs[0]->data = *input;
+}
+
+void InputNode::onConfigure(void* json)
+{
+	input = NULL;
+	JSON properties = getJSONObject(json, "properties");
+	if (!properties)
+		return;
+	readJSONString(properties, "name", name);
+	readJSONNumber(properties, "value", value);
+}
+
+bool InputNode::onCompile(LCompiler* compiler)
+{
+	std::string input = compiler->member(this, "input", "double", LCompiler::number(value)); //the host can write it between steps
+	compiler->declare(outputs[0], "double", input);
+	return true;
+}
+
+//*****************************
+
+SubgraphNode::SubgraphNode()
+{
+	CTOR_NODE();
+	flags |= NODE_ALWAYS_RUN;
+	subgraph = new LGraph();
+}
+
+SubgraphNode::~SubgraphNode()
+{
+	delete subgraph;
+}
+
+void SubgraphNode::onConfigure(void* json)
+{
+	subgraph_inputs.clear();
+	JSON subgraph_json = getJSONObject(json, "subgraph");
+	if (!subgraph_json)
+		return;
+	subgraph->clear();
+	if (!subgraph->configureFromJSON(subgraph_json))
+		std::cerr << "error configuring subgraph: " << id << std::endl;
+}
+
+void SubgraphNode::onExecute()
+{
+	if (subgraph_inputs.size() != inputs.size())
+	{
+		subgraph_inputs.resize(inputs.size());
+		for (unsigned int i = 0; i < inputs.size(); ++i)
+			subgraph_inputs[i] = subgraph->getInput(inputs[i]->name);
+		input_stamps.assign(inputs.size(), 0);
+		output_stamps.assign(outputs.size(), 0);
+	}
+
+	//copy only what changed
+	for (unsigned int i = 0; i < inputs.size(); ++i)
+	{
+		LData* data = inputs[i]->origin_data;
+		if (!data || (data->stamp == input_stamps[i] && subgraph_inputs[i]->type == data->type))
+			continue;
+		input_stamps[i] = data->stamp;
+		*subgraph_inputs[i] = *data;
+	}
+
+	subgraph->time = graph->time;
+	subgraph->runStep(0);
+
+	for (unsigned int i = 0; i < outputs.size(); ++i)
+	{
+		auto it = subgraph->outputs.find(outputs[i]->name);
+		if (it == subgraph->outputs.end() || !it->second)
+			continue;
+		LData* data = it->second;
+		if (data->stamp == output_stamps[i] && outputs[i]->data->type == data->type)
+			continue;
+		output_stamps[i] = data->stamp;
+		*outputs[i]->data = *data;
+	}
+}
+
+//the child nodes read directly from the nodes connected to our inputs, and the nodes connected to our outputs from the child nodes
+bool SubgraphNode::onInline(std::vector<LGraphNode*>& execution_order)
+{
+	subgraph->optimizations = graph->optimizations;
+	subgraph->buildExecutionPlan();
+	std::vector<LGraphNode*>& subgraph_order = subgraph->nodes_in_execution_order;
+	for (unsigned int i = 0; i < subgraph_order.size(); ++i)
+		subgraph_order[i]->order = -1;
+
+	for (unsigned int i = 0; i < subgraph_order.size(); ++i)
+	{
+		LGraphNode* node = subgraph_order[i];
+		if (!strcmp(node->getType(), "graph/input"))
+		{
+			//if our input is not connected the input node stays, so it provides its default value
+			InputNode* input_node = (InputNode*)node;
+			LSlot* input = getInputSlot(findInputSlotIndex(input_node->name));
+			if (input && input->origin)
+			{
+				std::vector<LSlot*>& targets = input_node->outputs[0]->targets;
+				for (unsigned int j = 0; j < targets.size(); ++j)
+				{
+					targets[j]->origin = input->origin;
+					targets[j]->origin_data = input->origin_data;
+					input->origin->targets.push_back(targets[j]);
+				}
+				continue;
+			}
+		}
+		else if (!strcmp(node->getType(), "graph/output"))
+		{
+			OutputNode* output_node = (OutputNode*)node;
+			LSlot* output = getOutputSlot(findOutputSlotIndex(output_node->name)); //NULL if we dont have an output with that name
+			LSlot* origin = output_node->inputs[0]->origin;
+			if (output)
+			{
+				for (unsigned int j = 0; j < output->targets.size(); ++j)
+				{
+					LSlot* target = output->targets[j];
+					target->origin = origin;
+					target->origin_data = origin ? origin->data : NULL;
+					if (origin)
+						origin->targets.push_back(target);
+				}
+			}
+			continue;
+		}
+		node->dirty = true;
+		execution_order.push_back(node);
+	}
+
+	graph->inlined_graphs.push_back(subgraph);
+	for (unsigned int i = 0; i < subgraph->inlined_graphs.size(); ++i)
+		graph->inlined_graphs.push_back(subgraph->inlined_graphs[i]);
+	subgraph->invalidateExecutionPlan(); //the child slots point to our graph now
+	return true;
+}
+
 
 //*****************************
 
 ConstNumberNode::ConstNumberNode()
 {
 	CTOR_NODE();
+	flags |= NODE_THREAD_SAFE | NODE_LANES | NODE_PURE | NODE_FUSABLE;
 	value = 4;
 	addOutput("out", DataType::NUMBER);
 }
@@ -30,6 +227,13 @@ void ConstNumberNode::onExecute()
 	setOutputData(0, value);
 }
 
+void ConstNumberNode::onExecuteLanes(const double* const* inputs, double* const* outputs, int num_lanes)
+{
+	double* out = outputs[0];
+	for (int i = 0; i < num_lanes; ++i)
+		out[i] = value;
+}
+
 void ConstNumberNode::onConfigure(void* json)
 {
 	JSON properties = getJSONObject(json, "properties");
@@ -38,9 +242,28 @@ void ConstNumberNode::onConfigure(void* json)
 	readJSONNumber(properties, "value", value);
 }
 
+bool ConstNumberNode::onCompile(LCompiler* compiler)
+{
+	compiler->declare(outputs[0], "double", LCompiler::number(value));
+	return true;
+}
+
+bool ConstNumberNode::onFuse(LFusedNode* fused)
+{
+	fused->output(this, 0, fused->op(FUSED_CONST, -1, -1, -1, value));
+	return true;
+}
+
+bool ConstNumberNode::getSignature(std::string& signature)
+{
+	signature.append((const char*)&value, sizeof(value));
+	return true;
+}
+
 ConstStringNode::ConstStringNode()
 {
 	CTOR_NODE();
+	flags |= NODE_THREAD_SAFE | NODE_PURE;
 	value = "";
 	addOutput("out", DataType::STRING);
 }
@@ -58,11 +281,18 @@ void ConstStringNode::onConfigure(void* json)
 	readJSONString(properties, "value", value);
 }
 
+bool ConstStringNode::onCompile(LCompiler* compiler)
+{
+	compiler->declare(outputs[0], "std::string", "std::string(" + LCompiler::quote(value) + ")");
+	return true;
+}
+
 
 
 ConstDataNode::ConstDataNode()
 {
 	CTOR_NODE();
+	flags |= NODE_THREAD_SAFE | NODE_PURE;
 	value = NULL;
 	addOutput("out", DataType::OBJECT);
 }
@@ -96,6 +326,7 @@ void ConstDataNode::onConfigure(void* json)
 ObjectPropertyNode::ObjectPropertyNode()
 {
 	CTOR_NODE();
+	flags |= NODE_THREAD_SAFE | NODE_PURE;
 	name = "";
 	addInput("in", DataType::JSON_OBJECT);
 	addOutput("out", DataType::ANY);
@@ -147,21 +378,50 @@ void ObjectPropertyNode::onConfigure(void* json)
 
 //*****************************
 
-GateNode::GateNode()
+GateNode::GateNode() : v(this, "v"), A(this, "A"), B(this, "B"), out(this, "out")
 {
 	CTOR_NODE();
-	addInput("v", DataType::BOOL);
-	addInput("A", DataType::NUMBER);
-	addInput("B", DataType::NUMBER);
-	addOutput("out", DataType::NUMBER);
+	flags |= NODE_THREAD_SAFE | NODE_LANES | NODE_PURE | NODE_FUSABLE;
 }
 
 void GateNode::onExecute()
 {
-	bool v = getInputDataAsBoolean(0);
-	double A = getInputDataAsNumber(1);
-	double B = getInputDataAsNumber(2);
-	setOutputData(0, v ? A : B );
+	out.set(v.get() ? A.get() : B.get());
+}
+
+void GateNode::onExecuteLanes(const double* const* inputs, double* const* outputs, int num_lanes)
+{
+	const double* v = inputs[0];
+	const double* A = inputs[1];
+	const double* B = inputs[2];
+	double* out = outputs[0];
+	for (int i = 0; i < num_lanes; ++i)
+		out[i] = v[i] != 0 ? A[i] : B[i];
+}
+
+void GateNode::executeBatch(LGraphNode* const* nodes, int count)
+{
+	for (int i = 0; i < count; ++i)
+	{
+		LGraphNode* node = nodes[i];
+		bool v = originBoolean(node->inputs[0]);
+		node->outputs[0]->data->assign(v ? originNumber(node->inputs[1]) : originNumber(node->inputs[2]));
+	}
+}
+
+bool GateNode::onFuse(LFusedNode* fused)
+{
+	int v = fused->input(this, 0, DataType::BOOL);
+	int A = fused->input(this, 1, DataType::NUMBER);
+	int B = fused->input(this, 2, DataType::NUMBER);
+	fused->output(this, 0, fused->op(FUSED_SELECT, v, A, B));
+	return true;
+}
+
+bool GateNode::onCompile(LCompiler* compiler)
+{
+	compiler->declare(outputs[0], "double", "(" + compiler->inputAsBoolean(this, 0) + " ? " + compiler->inputAsNumber(this, 1) + " : " + compiler->inputAsNumber(this, 2) + ")");
+	return true;
 }
 
 //*****************************
@@ -174,7 +434,13 @@ WatchNode::WatchNode()
 
 void WatchNode::onExecute()
 {
-	std::cout << "Out: " << getInputDataAsString(0) << std::endl;
+	std::cout << "Out: " << getInputDataAsStringView(0) << std::endl;
+}
+
+bool WatchNode::onCompile(LCompiler* compiler)
+{
+	compiler->code << "\tstd::cout << \"Out: \" << " << compiler->inputAsString(this, 0) << " << std::endl;\n";
+	return true;
 }
 
 
@@ -193,7 +459,15 @@ void ConsoleNode::onAction(int slot_index, const LEvent& event)
 {
 	LSlot* slot = inputs[slot_index];
 	if(slot)
-		std::cout << slot->name << ": " << event.type << std::endl;
+		std::cout << slot->name << ": " << event.getType() << std::endl;
+}
+
+bool ConsoleNode::onCompileAction(LCompiler* compiler, int slot_index, const std::string& event)
+{
+	LSlot* slot = getInputSlot(slot_index);
+	if (slot)
+		compiler->code << "\tstd::cout << " << LCompiler::quote(slot->name + ": ") << " << " << event << " << std::endl;\n";
+	return true;
 }
 
 //*************************
@@ -201,6 +475,7 @@ void ConsoleNode::onAction(int slot_index, const LEvent& event)
 TimeNode::TimeNode()
 {
 	CTOR_NODE();
+	flags |= NODE_THREAD_SAFE | NODE_ALWAYS_RUN | NODE_LANES | NODE_NO_SIDE_EFFECTS | NODE_FUSABLE;
 
 	addOutput("ms", DataType::NUMBER);
 	addOutput("sec", DataType::NUMBER);
@@ -212,11 +487,37 @@ void TimeNode::onExecute()
 	setOutputData( 1, graph->time );
 }
 
+void TimeNode::onExecuteLanes(const double* const* inputs, double* const* outputs, int num_lanes)
+{
+	double* ms = outputs[0];
+	double* sec = outputs[1];
+	for (int i = 0; i < num_lanes; ++i)
+	{
+		ms[i] = graph->time * 1000;
+		sec[i] = graph->time;
+	}
+}
+
+bool TimeNode::onFuse(LFusedNode* fused)
+{
+	fused->output(this, 0, fused->op(FUSED_TIME, -1, -1, -1, 1000));
+	fused->output(this, 1, fused->op(FUSED_TIME, -1, -1, -1, 1));
+	return true;
+}
+
+bool TimeNode::onCompile(LCompiler* compiler)
+{
+	compiler->declare(outputs[0], "double", "time * 1000");
+	compiler->declare(outputs[1], "double", "time");
+	return true;
+}
+
 //*************************
 
 ConditionNode::ConditionNode()
 {
 	CTOR_NODE();
+	flags |= NODE_THREAD_SAFE | NODE_LANES | NODE_PURE | NODE_FUSABLE;
 	OP = ConditionType::LESS;
 
 	addInput("A", DataType::NUMBER);
@@ -225,27 +526,111 @@ ConditionNode::ConditionNode()
 	addOutput("false", DataType::BOOL);
 }
 
-void ConditionNode::onExecute()
+static inline bool evaluateCondition(ConditionNode::ConditionType OP, double A, double B)
 {
-	double A = getInputDataAsNumber(0);
-	double B = getInputDataAsNumber(1);
-	bool C = false;
 	switch (OP)
 	{
-		case ConditionType::NEQUAL: C = A != B; break;
-		case ConditionType::EQUAL: C = A == B; break;
-		case ConditionType::LEQUAL: C = A <= B; break;
-		case ConditionType::LESS: C = A < B; break;
-		case ConditionType::GREATER: C = A > B; break;
-		case ConditionType::GEQUAL: C = A >= B; break;
-		case ConditionType::AND: C = A != 0 && B != 0; break;
-		case ConditionType::OR: C = A != 0 || B != 0; break;
-		default: break;
+		case ConditionNode::NEQUAL: return A != B;
+		case ConditionNode::EQUAL: return A == B;
+		case ConditionNode::LEQUAL: return A <= B;
+		case ConditionNode::LESS: return A < B;
+		case ConditionNode::GREATER: return A > B;
+		case ConditionNode::GEQUAL: return A >= B;
+		case ConditionNode::AND: return A != 0 && B != 0;
+		case ConditionNode::OR: return A != 0 || B != 0;
+		default: return false;
 	}
+}
+
+void ConditionNode::onExecute()
+{
+	bool C = evaluateCondition(OP, getInputDataAsNumber(0), getInputDataAsNumber(1));
 	setOutputData(0, C);
 	setOutputData(1, !C);
 }
 
+void ConditionNode::executeBatch(LGraphNode* const* nodes, int count)
+{
+	for (int i = 0; i < count; ++i)
+	{
+		ConditionNode* node = (ConditionNode*)nodes[i];
+		bool C = evaluateCondition(node->OP, originNumber(node->inputs[0]), originNumber(node->inputs[1]));
+		node->outputs[0]->data->assign(C);
+		node->outputs[1]->data->assign(!C);
+	}
+}
+
+//the switch is outside the loop so every case can be vectorized
+#define CONDITION_LANES(EXPR) for (int i = 0; i < num_lanes; ++i) { double a = A[i]; double b = B[i]; T[i] = (EXPR) ? 1.0 : 0.0; }
+
+void ConditionNode::onExecuteLanes(const double* const* inputs, double* const* outputs, int num_lanes)
+{
+	const double* A = inputs[0];
+	const double* B = inputs[1];
+	double* T = outputs[0];
+	double* F = outputs[1];
+	switch (OP)
+	{
+		case ConditionType::NEQUAL: CONDITION_LANES(a != b); break;
+		case ConditionType::EQUAL: CONDITION_LANES(a == b); break;
+		case ConditionType::LEQUAL: CONDITION_LANES(a <= b); break;
+		case ConditionType::LESS: CONDITION_LANES(a < b); break;
+		case ConditionType::GREATER: CONDITION_LANES(a > b); break;
+		case ConditionType::GEQUAL: CONDITION_LANES(a >= b); break;
+		case ConditionType::AND: CONDITION_LANES(a != 0 && b != 0); break;
+		case ConditionType::OR: CONDITION_LANES(a != 0 || b != 0); break;
+		default: memset(T, 0, num_lanes * sizeof(double)); break;
+	}
+	for (int i = 0; i < num_lanes; ++i)
+		F[i] = 1.0 - T[i];
+}
+
+bool ConditionNode::onFuse(LFusedNode* fused)
+{
+	int A = fused->input(this, 0, DataType::NUMBER);
+	int B = fused->input(this, 1, DataType::NUMBER);
+	FusedOpCode code = FUSED_CONST;
+	switch (OP)
+	{
+		case ConditionType::NEQUAL: code = FUSED_NEQUAL; break;
+		case ConditionType::EQUAL: code = FUSED_EQUAL; break;
+		case ConditionType::LEQUAL: code = FUSED_LEQUAL; break;
+		case ConditionType::LESS: code = FUSED_LESS; break;
+		case ConditionType::GREATER: code = FUSED_GREATER; break;
+		case ConditionType::GEQUAL: code = FUSED_GEQUAL; break;
+		case ConditionType::AND: code = FUSED_AND; break;
+		case ConditionType::OR: code = FUSED_OR; break;
+		default: break;
+	}
+	int C = fused->op(code, A, B);
+	fused->output(this, 0, C);
+	fused->output(this, 1, fused->op(FUSED_NOT, C));
+	return true;
+}
+
+//the operator is resolved at compile time
+bool ConditionNode::onCompile(LCompiler* compiler)
+{
+	std::string A = compiler->inputAsNumber(this, 0);
+	std::string B = compiler->inputAsNumber(this, 1);
+	std::string C;
+	switch (OP)
+	{
+		case ConditionType::NEQUAL: C = A + " != " + B; break;
+		case ConditionType::EQUAL: C = A + " == " + B; break;
+		case ConditionType::LEQUAL: C = A + " <= " + B; break;
+		case ConditionType::LESS: C = A + " < " + B; break;
+		case ConditionType::GREATER: C = A + " > " + B; break;
+		case ConditionType::GEQUAL: C = A + " >= " + B; break;
+		case ConditionType::AND: C = A + " != 0 && " + B + " != 0"; break;
+		case ConditionType::OR: C = A + " != 0 || " + B + " != 0"; break;
+		default: C = "false"; break;
+	}
+	std::string result = compiler->declare(outputs[0], "bool", "(" + C + ")");
+	compiler->declare(outputs[1], "bool", "!" + result);
+	return true;
+}
+
 void ConditionNode::onConfigure(void* json)
 {
 	JSON properties = getJSONObject(json, "properties");
@@ -283,6 +668,7 @@ void ConditionNode::onConfigure(void* json)
 TrigonometryNode::TrigonometryNode()
 {
 	CTOR_NODE();
+	flags |= NODE_THREAD_SAFE | NODE_LANES | NODE_PURE | NODE_FUSABLE;
 	amplitude = 1;
 	offset = 0;
 	addInput("v", DataType::NUMBER);
@@ -314,6 +700,27 @@ void TrigonometryNode::onExecute()
 	}
 }
 
+void TrigonometryNode::onExecuteLanes(const double* const* inputs, double* const* outputs, int num_lanes)
+{
+	const double* v = inputs[0];
+	for (unsigned int j = 0; j < this->outputs.size(); ++j)
+	{
+		if (!this->outputs[j]->isConnected())
+			continue;
+		double* out = outputs[j];
+		switch (this->outputs[j]->custom_type)
+		{
+			case SIN: for (int i = 0; i < num_lanes; ++i) out[i] = sin(v[i]) * amplitude + offset; break;
+			case COS: for (int i = 0; i < num_lanes; ++i) out[i] = cos(v[i]) * amplitude + offset; break;
+			case TAN: for (int i = 0; i < num_lanes; ++i) out[i] = tan(v[i]) * amplitude + offset; break;
+			case ASIN: for (int i = 0; i < num_lanes; ++i) out[i] = asin(v[i]) * amplitude + offset; break;
+			case ACOS: for (int i = 0; i < num_lanes; ++i) out[i] = acos(v[i]) * amplitude + offset; break;
+			case ATAN: for (int i = 0; i < num_lanes; ++i) out[i] = atan(v[i]) * amplitude + offset; break;
+			default: break;
+		}
+	}
+}
+
 void TrigonometryNode::onConfigure(void* json)
 {
 	JSON properties = getJSONObject(json, "properties");
@@ -346,12 +753,99 @@ void TrigonometryNode::onConfigure(void* json)
 	}
 }
 
+void TrigonometryNode::executeBatch(LGraphNode* const* nodes, int count)
+{
+	for (int i = 0; i < count; ++i)
+	{
+		TrigonometryNode* node = (TrigonometryNode*)nodes[i];
+		double v = originNumber(node->inputs[0]);
+		for (unsigned int j = 0; j < node->outputs.size(); ++j)
+		{
+			LSlot* slot = node->outputs[j];
+			if (!slot->isConnected())
+				continue;
+			double tv = 0;
+			switch (slot->custom_type)
+			{
+				case SIN: tv = sin(v); break;
+				case COS: tv = cos(v); break;
+				case TAN: tv = tan(v); break;
+				case ASIN: tv = asin(v); break;
+				case ACOS: tv = acos(v); break;
+				case ATAN: tv = atan(v); break;
+				default: break;
+			}
+			slot->data->assign(tv * node->amplitude + node->offset);
+		}
+	}
+}
+
+bool TrigonometryNode::onFuse(LFusedNode* fused)
+{
+	int v = isInputConnected(0) ? fused->input(this, 0, DataType::NUMBER) : fused->op(FUSED_CONST);
+	for (unsigned int i = 0; i < outputs.size(); ++i)
+	{
+		LSlot* slot = outputs[i];
+		if (!slot->isConnected())
+			continue;
+		FusedOpCode code = FUSED_SIN;
+		switch (slot->custom_type)
+		{
+			case COS: code = FUSED_COS; break;
+			case TAN: code = FUSED_TAN; break;
+			case ASIN: code = FUSED_ASIN; break;
+			case ACOS: code = FUSED_ACOS; break;
+			case ATAN: code = FUSED_ATAN; break;
+			default: break;
+		}
+		fused->output(this, i, fused->op(code, v, -1, -1, amplitude, offset));
+	}
+	return true;
+}
+
+//only the connected outputs are computed, so they are part of the signature
+bool TrigonometryNode::getSignature(std::string& signature)
+{
+	signature.append((const char*)&amplitude, sizeof(amplitude));
+	signature.append((const char*)&offset, sizeof(offset));
+	for (unsigned int i = 0; i < outputs.size(); ++i)
+	{
+		signature += (char)outputs[i]->custom_type;
+		signature += outputs[i]->isConnected() ? '1' : '0';
+	}
+	return true;
+}
+
+bool TrigonometryNode::onCompile(LCompiler* compiler)
+{
+	std::string v = isInputConnected(0) ? compiler->inputAsNumber(this, 0) : "0.0";
+	for (unsigned int i = 0; i < outputs.size(); ++i)
+	{
+		LSlot* slot = outputs[i];
+		if (!slot->isConnected())
+			continue;
+		const char* func = "sin";
+		switch (slot->custom_type)
+		{
+			case COS: func = "cos"; break;
+			case TAN: func = "tan"; break;
+			case ASIN: func = "asin"; break;
+			case ACOS: func = "acos"; break;
+			case ATAN: func = "atan"; break;
+			default: break;
+		}
+		compiler->declare(slot, "double", std::string(func) + "(" + v + ") * " + LCompiler::number(amplitude) + " + " + LCompiler::number(offset));
+	}
+	return true;
+}
+
 
 //**************************************
 
 TimerNode::TimerNode()
 {
 	CTOR_NODE();
+	flags |= NODE_ALWAYS_RUN;
 	addOutput("on_tick", DataType::EVENT);
 	_next_trigger = 0;
 	interval = 1000;
@@ -365,7 +859,8 @@ void TimerNode::onExecute()
 	if (graph->time < _next_trigger)
 		return;
 	_next_trigger = graph->time + interval * 0.001;
-	trigger(0, LEvent("tick"));
+	static const int tick = internEventType("tick");
+	trigger(0, LEvent(tick));
 }
 
 void TimerNode::onConfigure(void* json)
@@ -377,10 +872,25 @@ void TimerNode::onConfigure(void* json)
 	readJSONNumber(properties, "interval", interval);
 }
 
+bool TimerNode::onCompile(LCompiler* compiler)
+{
+	std::string interval_member = compiler->member(this, "interval", "double", LCompiler::number(interval));
+	std::string next_trigger = compiler->member(this, "next_trigger", "double", "0.0");
+	if (isInputConnected(0))
+		compiler->code << "\t" << interval_member << " = " << compiler->inputAsNumber(this, 0) << ";\n";
+	compiler->code << "\tif (!(time < " << next_trigger << "))\n\t{\n";
+	compiler->code << "\t\t" << next_trigger << " = time + " << interval_member << " * 0.001;\n";
+	bool valid = compiler->trigger(this, 0, "\"tick\"");
+	compiler->code << "\t}\n";
+	return valid;
+}
+
 
 void LiteGraph::initBaseNodes()
 {
 	OutputNode* output_node = new OutputNode();
+	InputNode* input_node = new InputNode();
+	SubgraphNode* subgraph_node = new SubgraphNode();
 	TrigonometryNode* trigonometry_node = new TrigonometryNode();
 	ConsoleNode* console_node = new ConsoleNode();
 	TimerNode* timer_node = new TimerNode();
@@ -3,16 +3,59 @@
 #include "../litegraph.h"
 using namespace LiteGraph;
 
+//publishes its input in graph->outputs when the plan is built (not while executing, so it is thread safe)
 class OutputNode : public LGraphNode
 {
 public:
 	REGISTERNODE("graph/output", OutputNode);
 
-	OutputNode();
+	std::string name;
 
-	void onExecute()
+	OutputNode();
+	void onExecute() {}
+	void onExecuteLanes(const double* const* inputs, double* const* outputs, int num_lanes)
 	{
 	}
+	void onPlanBuilt();
+	void onConfigure(void* json);
+	bool onCompile(LCompiler* compiler) { return true; }
+};
+
+//reads graph->inputs[name], uses the value property until the host sets it
+class InputNode : public LGraphNode
+{
+public:
+	REGISTERNODE("graph/input", InputNode);
+
+	std::string name;
+	double value;
+	LData* input;
+	unsigned int input_stamp;
+
+	InputNode();
+	void onExecute();
+	void onConfigure(void* json);
+	bool onCompile(LCompiler* compiler);
+};
+
+//contains a child graph, its inputs and outputs are the graph/input and graph/output nodes of the child
+class SubgraphNode : public LGraphNode
+{
+public:
+	REGISTERNODE("graph/subgraph", SubgraphNode);
+
+	LGraph* subgraph;
+
+	SubgraphNode();
+	virtual ~SubgraphNode();
+	void onExecute();
+	void onConfigure(void* json);
+	bool onInline(std::vector<LGraphNode*>& execution_order);
+
+private:
+	std::vector<LData*> subgraph_inputs; //resolved the first time
+	std::vector<unsigned int> input_stamps;
+	std::vector<unsigned int> output_stamps;
 };
 
 class WatchNode : public LGraphNode
@@ -22,6 +65,7 @@ public:
 
 	WatchNode();
 	void onExecute();
+	bool onCompile(LCompiler* compiler);
 };
 
 class ConsoleNode : public LGraphNode
@@ -32,6 +76,8 @@ public:
 	ConsoleNode();
 	void onExecute();
 	void onAction(int slot, const LEvent& event);
+	bool onCompile(LCompiler* compiler) { return true; }
+	bool onCompileAction(LCompiler* compiler, int slot, const std::string& event);
 };
 
 class TimeNode : public LGraphNode
@@ -41,6 +87,9 @@ public:
 
 	TimeNode();
 	void onExecute();
+	void onExecuteLanes(const double* const* inputs, double* const* outputs, int num_lanes);
+	bool onCompile(LCompiler* compiler);
+	bool onFuse(LFusedNode* fused);
 };
 
 // *********************
@@ -54,7 +103,11 @@ public:
 
 	ConstNumberNode();
 	void onExecute();
+	void onExecuteLanes(const double* const* inputs, double* const* outputs, int num_lanes);
 	void onConfigure(void* json);
+	bool onCompile(LCompiler* compiler);
+	bool onFuse(LFusedNode* fused);
+	bool getSignature(std::string& signature);
 };
 
 class ConstStringNode : public LGraphNode
@@ -67,6 +120,8 @@ public:
 	ConstStringNode();
 	void onExecute();
 	void onConfigure(void* json);
+	bool onCompile(LCompiler* compiler);
+	bool getSignature(std::string& signature) { signature += value; return true; }
 };
 
 class ConstDataNode : public LGraphNode
@@ -93,6 +148,7 @@ public:
 	ObjectPropertyNode();
 	void onExecute();
 	void onConfigure(void* json);
+	bool getSignature(std::string& signature) { signature += name; return true; }
 };
 
 // *********************
@@ -101,8 +157,20 @@ class GateNode : public LGraphNode
 {
 public:
 	REGISTERNODE("math/gate", GateNode);
+
+	LInput<bool> v;
+	LInput<double> A;
+	LInput<double> B;
+	LOutput<double> out;
+
 	GateNode();
 	void onExecute();
+	void onExecuteLanes(const double* const* inputs, double* const* outputs, int num_lanes);
+	bool onCompile(LCompiler* compiler);
+	bool onFuse(LFusedNode* fused);
+	static void executeBatch(LGraphNode* const* nodes, int count);
+	BatchKernel getBatchKernel() { return executeBatch; }
+	bool getSignature(std::string& signature) { return true; }
 };
 
 class ConditionNode : public LGraphNode
@@ -118,7 +186,13 @@ public:
 
 	ConditionNode();
 	void onExecute();
+	void onExecuteLanes(const double* const* inputs, double* const* outputs, int num_lanes);
 	void onConfigure(void* json);
+	bool onCompile(LCompiler* compiler);
+	bool onFuse(LFusedNode* fused);
+	static void executeBatch(LGraphNode* const* nodes, int count);
+	BatchKernel getBatchKernel() { return executeBatch; }
+	bool getSignature(std::string& signature) { signature += (char)OP; return true; }
 };
 
 class TrigonometryNode : public LGraphNode
@@ -133,7 +207,13 @@ public:
 
 	TrigonometryNode();
 	void onExecute();
+	void onExecuteLanes(const double* const* inputs, double* const* outputs, int num_lanes);
 	void onConfigure(void* json);
+	bool onCompile(LCompiler* compiler);
+	bool onFuse(LFusedNode* fused);
+	static void executeBatch(LGraphNode* const* nodes, int count);
+	BatchKernel getBatchKernel() { return executeBatch; }
+	bool getSignature(std::string& signature);
 };
 
 
@@ -150,4 +230,5 @@ public:
 	TimerNode();
 	void onExecute();
 	void onConfigure(void* json);
+	bool onCompile(LCompiler* compiler);
 };
\ No newline at end of file
@@ -0,0 +1,366 @@
+#include "buffer.h"
+#include <iostream>
+#include <cmath>
+
+#if defined(__AVX__)
+	#include <immintrin.h>
+	#define BUFFER_SIMD_AVX
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+	#include <emmintrin.h>
+	#define BUFFER_SIMD_SSE2
+#endif
+
+using namespace LiteGraph;
+
+//kernels, written once over a vector type: the SIMD registers for float and double, a single value otherwise (int)
+//so the loop of every kernel is the same for all the types and the remaining elements use the scalar version
+
+template<class T> struct SimdTraits {
+	typedef T Vec;
+	enum { N = 1 };
+	static T load(const T* p) { return *p; }
+	static void store(T* p, T v) { *p = v; }
+	static T set(T v) { return v; }
+};
+
+template<class T> static inline T simdAdd(T a, T b) { return a + b; }
+template<class T> static inline T simdSub(T a, T b) { return a - b; }
+template<class T> static inline T simdMul(T a, T b) { return a * b; }
+template<class T> static inline T simdDiv(T a, T b) { return a / b; }
+static inline int simdDiv(int a, int b) { return b ? a / b : 0; }
+template<class T> static inline T simdMin(T a, T b) { return a < b ? a : b; }
+template<class T> static inline T simdMax(T a, T b) { return a > b ? a : b; }
+template<class T> static inline T simdEqual(T a, T b) { return a == b ? 1 : 0; }
+template<class T> static inline T simdNEqual(T a, T b) { return a != b ? 1 : 0; }
+template<class T> static inline T simdGreater(T a, T b) { return a > b ? 1 : 0; }
+template<class T> static inline T simdGEqual(T a, T b) { return a >= b ? 1 : 0; }
+template<class T> static inline T simdLess(T a, T b) { return a < b ? 1 : 0; }
+template<class T> static inline T simdLEqual(T a, T b) { return a <= b ? 1 : 0; }
+
+#if defined(BUFFER_SIMD_AVX)
+	#define SIMD_CMP(P, S, a, b, AVX_PREDICATE, SSE_NAME) P##_cmp_##S(a, b, AVX_PREDICATE)
+	#define SIMD_TYPES(X) X(float, __m256, _mm256, ps) X(double, __m256d, _mm256, pd)
+#elif defined(BUFFER_SIMD_SSE2)
+	#define SIMD_CMP(P, S, a, b, AVX_PREDICATE, SSE_NAME) P##_##SSE_NAME##_##S(a, b)
+	#define SIMD_TYPES(X) X(float, __m128, _mm, ps) X(double, __m128d, _mm, pd)
+#else
+	#define SIMD_TYPES(X)
+#endif
+
+//compare results are masks, and-ed with 1 to get 1 or 0
+#define SIMD_DEFINE(T, V, P, S) \
+	template<> struct SimdTraits<T> { \
+		typedef V Vec; \
+		enum { N = sizeof(V) / sizeof(T) }; \
+		static V load(const T* p) { return P##_load_##S(p); } \
+		static void store(T* p, V v) { P##_store_##S(p, v); } \
+		static V set(T v) { return P##_set1_##S(v); } \
+	}; \
+	static inline V simdAdd(V a, V b) { return P##_add_##S(a, b); } \
+	static inline V simdSub(V a, V b) { return P##_sub_##S(a, b); } \
+	static inline V simdMul(V a, V b) { return P##_mul_##S(a, b); } \
+	static inline V simdDiv(V a, V b) { return P##_div_##S(a, b); } \
+	static inline V simdMin(V a, V b) { return P##_min_##S(a, b); } \
+	static inline V simdMax(V a, V b) { return P##_max_##S(a, b); } \
+	static inline V simdMask(V m) { return P##_and_##S(m, P##_set1_##S(1)); } \
+	static inline V simdEqual(V a, V b) { return simdMask(SIMD_CMP(P, S, a, b, _CMP_EQ_OQ, cmpeq)); } \
+	static inline V simdNEqual(V a, V b) { return simdMask(SIMD_CMP(P, S, a, b, _CMP_NEQ_UQ, cmpneq)); } \
+	static inline V simdGreater(V a, V b) { return simdMask(SIMD_CMP(P, S, a, b, _CMP_GT_OQ, cmpgt)); } \
+	static inline V simdGEqual(V a, V b) { return simdMask(SIMD_CMP(P, S, a, b, _CMP_GE_OQ, cmpge)); } \
+	static inline V simdLess(V a, V b) { return simdMask(SIMD_CMP(P, S, a, b, _CMP_LT_OQ, cmplt)); } \
+	static inline V simdLEqual(V a, V b) { return simdMask(SIMD_CMP(P, S, a, b, _CMP_LE_OQ, cmple)); }
+
+SIMD_TYPES(SIMD_DEFINE)
+
+//out = func(a, b), b is NULL to use b_value for all the elements
+//the buffers are aligned to 32 bytes so the aligned loads are safe
+template<class T, class F>
+static void applyBinary(T* out, const T* a, const T* b, T b_value, int length, F func)
+{
+	typedef SimdTraits<T> S;
+	int i = 0;
+	if (b)
+	{
+		for (; i + S::N <= length; i += S::N)
+			S::store(out + i, func(S::load(a + i), S::load(b + i)));
+		for (; i < length; ++i)
+			out[i] = func(a[i], b[i]);
+	}
+	else
+	{
+		typename S::Vec vb = S::set(b_value);
+		for (; i + S::N <= length; i += S::N)
+			S::store(out + i, func(S::load(a + i), vb));
+		for (; i < length; ++i)
+			out[i] = func(a[i], b_value);
+	}
+}
+
+template<class T>
+static void applyOperation(BufferBinaryNode::OperationType op, T* out, const T* a, const T* b, T b_value, int length)
+{
+	switch (op)
+	{
+		case BufferBinaryNode::ADD: applyBinary(out, a, b, b_value, length, [](auto x, auto y) { return simdAdd(x, y); }); break;
+		case BufferBinaryNode::SUB: applyBinary(out, a, b, b_value, length, [](auto x, auto y) { return simdSub(x, y); }); break;
+		case BufferBinaryNode::MUL: applyBinary(out, a, b, b_value, length, [](auto x, auto y) { return simdMul(x, y); }); break;
+		case BufferBinaryNode::DIV: applyBinary(out, a, b, b_value, length, [](auto x, auto y) { return simdDiv(x, y); }); break;
+		case BufferBinaryNode::MIN: applyBinary(out, a, b, b_value, length, [](auto x, auto y) { return simdMin(x, y); }); break;
+		case BufferBinaryNode::MAX: applyBinary(out, a, b, b_value, length, [](auto x, auto y) { return simdMax(x, y); }); break;
+		case BufferBinaryNode::EQUAL: applyBinary(out, a, b, b_value, length, [](auto x, auto y) { return simdEqual(x, y); }); break;
+		case BufferBinaryNode::NEQUAL: applyBinary(out, a, b, b_value, length, [](auto x, auto y) { return simdNEqual(x, y); }); break;
+		case BufferBinaryNode::GREATER: applyBinary(out, a, b, b_value, length, [](auto x, auto y) { return simdGreater(x, y); }); break;
+		case BufferBinaryNode::GEQUAL: applyBinary(out, a, b, b_value, length, [](auto x, auto y) { return simdGEqual(x, y); }); break;
+		case BufferBinaryNode::LESS: applyBinary(out, a, b, b_value, length, [](auto x, auto y) { return simdLess(x, y); }); break;
+		case BufferBinaryNode::LEQUAL: applyBinary(out, a, b, b_value, length, [](auto x, auto y) { return simdLEqual(x, y); }); break;
+	}
+}
+
+template<class T>
+static void applyClamp(T* out, const T* a, T min, T max, int length)
+{
+	typedef SimdTraits<T> S;
+	typename S::Vec vmin = S::set(min);
+	typename S::Vec vmax = S::set(max);
+	int i = 0;
+	for (; i + S::N <= length; i += S::N)
+		S::store(out + i, simdMin(simdMax(S::load(a + i), vmin), vmax));
+	for (; i < length; ++i)
+		out[i] = simdMin(simdMax(a[i], min), max);
+}
+
+//there are no SIMD instructions for these, the loop is left to the compiler
+template<class T>
+static void applyTrigonometry(BufferTrigonometryNode::FuncType func, T* out, const T* a, double amplitude, double offset, int length)
+{
+	switch (func)
+	{
+		case BufferTrigonometryNode::SIN: for (int i = 0; i < length; ++i) out[i] = (T)(sin((double)a[i]) * amplitude + offset); break;
+		case BufferTrigonometryNode::COS: for (int i = 0; i < length; ++i) out[i] = (T)(cos((double)a[i]) * amplitude + offset); break;
+		case BufferTrigonometryNode::TAN: for (int i = 0; i < length; ++i) out[i] = (T)(tan((double)a[i]) * amplitude + offset); break;
+		case BufferTrigonometryNode::ASIN: for (int i = 0; i < length; ++i) out[i] = (T)(asin((double)a[i]) * amplitude + offset); break;
+		case BufferTrigonometryNode::ACOS: for (int i = 0; i < length; ++i) out[i] = (T)(acos((double)a[i]) * amplitude + offset); break;
+		case BufferTrigonometryNode::ATAN: for (int i = 0; i < length; ++i) out[i] = (T)(atan((double)a[i]) * amplitude + offset); break;
+		default: break;
+	}
+}
+
+//*****************************
+
+BufferBinaryNode::BufferBinaryNode()
+{
+	flags |= NODE_THREAD_SAFE | NODE_PURE;
+	B = 0;
+	OP = ADD;
+	addInput("A", DataType::BUFFER);
+	addInput("B", DataType::ANY);
+	addOutput("out", DataType::BUFFER);
+}
+
+void BufferBinaryNode::onExecute()
+{
+	LData* output = outputs[0]->data;
+	LData* data_a = getInputData(0);
+	BufferType type = BUFFER_FLOAT32;
+	int length = 0;
+	const void* a = data_a ? data_a->getBuffer(type, length) : NULL;
+	if (!a)
+	{
+		output->editBuffer(type, 0);
+		return;
+	}
+
+	//B is a buffer like A or a number
+	const void* b = NULL;
+	double b_value = B;
+	LData* data_b = getInputData(1);
+	if (data_b && data_b->type == DataType::BUFFER)
+	{
+		BufferType type_b;
+		int length_b;
+		b = data_b->getBuffer(type_b, length_b);
+		if (type_b != type || length_b != length)
+		{
+			output->editBuffer(type, 0);
+			return;
+		}
+	}
+	else if (data_b)
+		b_value = getInputDataAsNumber(1);
+
+	void* out = output->editBuffer(type, length);
+	switch (type)
+	{
+		case BUFFER_FLOAT32: applyOperation(OP, (float*)out, (const float*)a, (const float*)b, (float)b_value, length); break;
+		case BUFFER_FLOAT64: applyOperation(OP, (double*)out, (const double*)a, (const double*)b, b_value, length); break;
+		case BUFFER_INT32: applyOperation(OP, (int*)out, (const int*)a, (const int*)b, (int)b_value, length); break;
+	}
+}
+
+void BufferBinaryNode::onConfigure(void* json)
+{
+	JSON properties = getJSONObject(json, "properties");
+	if (!properties)
+		return;
+	readJSONNumber(properties, "B", B);
+	std::string op;
+	if (readJSONString(properties, "OP", op))
+	{
+		if (op == "+")
+			OP = ADD;
+		else if (op == "-")
+			OP = SUB;
+		else if (op == "*")
+			OP = MUL;
+		else if (op == "/")
+			OP = DIV;
+		else if (op == "min")
+			OP = MIN;
+		else if (op == "max")
+			OP = MAX;
+		else if (op == "==")
+			OP = EQUAL;
+		else if (op == "!=")
+			OP = NEQUAL;
+		else if (op == ">")
+			OP = GREATER;
+		else if (op == ">=")
+			OP = GEQUAL;
+		else if (op == "<")
+			OP = LESS;
+		else if (op == "<=")
+			OP = LEQUAL;
+		else
+			std::cout << "unknown buffer operation: " << op << std::endl;
+	}
+}
+
+BufferOperationNode::BufferOperationNode()
+{
+	CTOR_NODE();
+	OP = ADD;
+}
+
+BufferCompareNode::BufferCompareNode()
+{
+	CTOR_NODE();
+	OP = GREATER;
+}
+
+//*****************************
+
+BufferClampNode::BufferClampNode()
+{
+	CTOR_NODE();
+	flags |= NODE_THREAD_SAFE | NODE_PURE;
+	min = 0;
+	max = 1;
+	addInput("in", DataType::BUFFER);
+	addOutput("out", DataType::BUFFER);
+}
+
+void BufferClampNode::onExecute()
+{
+	LData* output = outputs[0]->data;
+	LData* data = getInputData(0);
+	BufferType type = BUFFER_FLOAT32;
+	int length = 0;
+	const void* a = data ? data->getBuffer(type, length) : NULL;
+	if (!a)
+		length = 0;
+
+	void* out = output->editBuffer(type, length);
+	switch (type)
+	{
+		case BUFFER_FLOAT32: applyClamp((float*)out, (const float*)a, (float)min, (float)max, length); break;
+		case BUFFER_FLOAT64: applyClamp((double*)out, (const double*)a, min, max, length); break;
+		case BUFFER_INT32: applyClamp((int*)out, (const int*)a, (int)min, (int)max, length); break;
+	}
+}
+
+void BufferClampNode::onConfigure(void* json)
+{
+	JSON properties = getJSONObject(json, "properties");
+	if (!properties)
+		return;
+	readJSONNumber(properties, "min", min);
+	readJSONNumber(properties, "max", max);
+}
+
+//*****************************
+
+BufferTrigonometryNode::BufferTrigonometryNode()
+{
+	CTOR_NODE();
+	flags |= NODE_THREAD_SAFE | NODE_PURE;
+	amplitude = 1;
+	offset = 0;
+	addInput("v", DataType::BUFFER);
+	addOutput("sin", DataType::BUFFER)->custom_type = SIN;
+}
+
+void BufferTrigonometryNode::onExecute()
+{
+	LData* data = getInputData(0);
+	BufferType type = BUFFER_FLOAT32;
+	int length = 0;
+	const void* a = data ? data->getBuffer(type, length) : NULL;
+	if (!a)
+		length = 0;
+
+	for (unsigned int i = 0; i < outputs.size(); ++i)
+	{
+		LSlot* slot = outputs[i];
+		if (!slot->isConnected())
+			continue;
+		FuncType func = (FuncType)slot->custom_type;
+		void* out = slot->data->editBuffer(type, length);
+		switch (type)
+		{
+			case BUFFER_FLOAT32: applyTrigonometry(func, (float*)out, (const float*)a, amplitude, offset, length); break;
+			case BUFFER_FLOAT64: applyTrigonometry(func, (double*)out, (const double*)a, amplitude, offset, length); break;
+			case BUFFER_INT32: applyTrigonometry(func, (int*)out, (const int*)a, amplitude, offset, length); break;
+		}
+	}
+}
+
+void BufferTrigonometryNode::onConfigure(void* json)
+{
+	JSON properties = getJSONObject(json, "properties");
+	if (properties)
+	{
+		readJSONNumber(properties, "amplitude", amplitude);
+		readJSONNumber(properties, "offset", offset);
+	}
+
+	for (unsigned int i = 0; i < outputs.size(); ++i)
+	{
+		LSlot* slot = outputs[i];
+		if (slot->name == "sin")
+			slot->custom_type = SIN;
+		else if (slot->name == "cos")
+			slot->custom_type = COS;
+		else if (slot->name == "tan")
+			slot->custom_type = TAN;
+		else if (slot->name == "asin")
+			slot->custom_type = ASIN;
+		else if (slot->name == "acos")
+			slot->custom_type = ACOS;
+		else if (slot->name == "atan")
+			slot->custom_type = ATAN;
+		else
+		{
+			std::cout << "unknown trigonometric function: " << slot->name << std::endl;
+			slot->custom_type = SIN;
+		}
+	}
+}
+
+void LiteGraph::initBufferNodes()
+{
+	//the constructors register the prototypes
+	new BufferOperationNode();
+	new BufferCompareNode();
+	new BufferClampNode();
+	new BufferTrigonometryNode();
+}
@@ -0,0 +1,65 @@
+#pragma once
+
+#include "../litegraph.h"
+using namespace LiteGraph;
+
+//nodes that work over DataType::BUFFER, elementwise with SIMD kernels
+//the output has the type and length of the first input, if the inputs dont match the output is empty
+
+//base of operation and compare, B can be a buffer or a number (applied to every element)
+class BufferBinaryNode : public LGraphNode
+{
+public:
+	enum OperationType { ADD, SUB, MUL, DIV, MIN, MAX, EQUAL, NEQUAL, GREATER, GEQUAL, LESS, LEQUAL };
+
+	double B; //used if B is not connected
+	OperationType OP;
+
+	BufferBinaryNode();
+	void onExecute();
+	void onConfigure(void* json);
+};
+
+class BufferOperationNode : public BufferBinaryNode
+{
+public:
+	REGISTERNODE("buffer/operation", BufferOperationNode);
+	BufferOperationNode();
+};
+
+//the result is 1 or 0
+class BufferCompareNode : public BufferBinaryNode
+{
+public:
+	REGISTERNODE("buffer/compare", BufferCompareNode);
+	BufferCompareNode();
+};
+
+class BufferClampNode : public LGraphNode
+{
+public:
+	REGISTERNODE("buffer/clamp", BufferClampNode);
+
+	double min;
+	double max;
+
+	BufferClampNode();
+	void onExecute();
+	void onConfigure(void* json);
+};
+
+//same as math/trigonometry, the outputs are named after the function
+class BufferTrigonometryNode : public LGraphNode
+{
+public:
+	REGISTERNODE("buffer/trigonometry", BufferTrigonometryNode);
+
+	double amplitude;
+	double offset;
+
+	enum FuncType { NONE, SIN, COS, TAN, ASIN, ACOS, ATAN };
+
+	BufferTrigonometryNode();
+	void onExecute();
+	void onConfigure(void* json);
+};
@@ -0,0 +1,103 @@
+#include "runner.h"
+
+#include <thread>
+
+const double LiteGraph::LGraphRunner::jitter_buckets[RUNNER_JITTER_BUCKETS] = { 0.00001, 0.000025, 0.00005, 0.0001, 0.00025, 0.0005, 0.001, 0.0025, 0.005, 0.01, 1e10 };
+
+LiteGraph::LGraphRunner::LGraphRunner(LGraph* graph, double timestep)
+{
+	this->graph = graph;
+	this->timestep = timestep;
+	max_steps_per_tick = 5;
+	spin_time = 0.002;
+	started = false;
+	accumulator = 0;
+	resetStats();
+}
+
+void LiteGraph::LGraphRunner::resetStats()
+{
+	steps = 0;
+	overruns = 0;
+	dropped_steps = 0;
+	max_jitter = 0;
+	for (int i = 0; i < RUNNER_JITTER_BUCKETS; ++i)
+		jitter_histogram[i] = 0;
+}
+
+void LiteGraph::LGraphRunner::start()
+{
+	started = true;
+	accumulator = 0;
+	last_time = clock::now();
+	deadline = last_time;
+	resetStats();
+}
+
+void LiteGraph::LGraphRunner::waitUntil(clock::time_point time)
+{
+	std::chrono::duration<double> spin(spin_time);
+	clock::time_point now = clock::now();
+	if (time - now > spin)
+		std::this_thread::sleep_for(time - now - spin);
+	while (clock::now() < time)
+		std::this_thread::yield();
+}
+
+int LiteGraph::LGraphRunner::tick()
+{
+	if (!started)
+		start();
+
+	std::chrono::duration<double> step_duration(timestep);
+	waitUntil(deadline);
+
+	clock::time_point now = clock::now();
+	double jitter = std::chrono::duration<double>(now - deadline).count();
+	if (jitter > max_jitter)
+		max_jitter = jitter;
+	int bucket = 0;
+	while (jitter > jitter_buckets[bucket] && bucket < RUNNER_JITTER_BUCKETS - 1)
+		++bucket;
+	jitter_histogram[bucket]++;
+
+	accumulator += std::chrono::duration<double>(now - last_time).count();
+	last_time = now;
+
+	int num_steps = 0;
+	while (accumulator >= timestep && num_steps < max_steps_per_tick)
+	{
+		clock::time_point step_start = clock::now();
+		graph->runStep((float)timestep);
+		if (clock::now() - step_start > step_duration)
+			overruns++;
+		accumulator -= timestep;
+		num_steps++;
+	}
+	steps += num_steps;
+
+	//too far behind, drop the steps we cannot do and resync
+	if (accumulator >= timestep)
+	{
+		unsigned long long num_dropped = (unsigned long long)(accumulator / timestep);
+		dropped_steps += num_dropped;
+		accumulator -= num_dropped * timestep;
+		deadline = now;
+	}
+
+	deadline += std::chrono::duration_cast<clock::duration>(step_duration);
+	return num_steps;
+}
+
+void LiteGraph::LGraphRunner::printStats(std::ostream& stream)
+{
+	stream << "steps: " << steps << " overruns: " << overruns << " dropped: " << dropped_steps << " max jitter: " << max_jitter * 1000 << "ms" << std::endl;
+	for (int i = 0; i < RUNNER_JITTER_BUCKETS; ++i)
+	{
+		if (i < RUNNER_JITTER_BUCKETS - 1)
+			stream << " <" << jitter_buckets[i] * 1000 << "ms: ";
+		else
+			stream << " more: ";
+		stream << jitter_histogram[i] << std::endl;
+	}
+}
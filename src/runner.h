@@ -0,0 +1,47 @@
+#pragma once
+
+#include "litegraph.h"
+
+#include <chrono>
+
+#define RUNNER_JITTER_BUCKETS 11
+
+namespace LiteGraph {
+
+	//runs a graph in real time with a fixed timestep
+	//waits for every step deadline sleeping and spinning the last part (sleep is not precise enough),
+	//if it falls behind it catches up with several steps per tick, up to max_steps_per_tick
+	class LGraphRunner {
+	public:
+		typedef std::chrono::steady_clock clock;
+
+		LGraph* graph;				//not owned
+		double timestep;			//in seconds
+		int max_steps_per_tick;		//the rest is dropped
+		double spin_time;			//seconds before the deadline when it stops sleeping and starts spinning
+
+		//stats
+		unsigned long long steps;
+		unsigned long long overruns;		//steps that took longer than the timestep
+		unsigned long long dropped_steps;	//steps skipped to catch up
+		double max_jitter;					//in seconds
+		unsigned long long jitter_histogram[RUNNER_JITTER_BUCKETS]; //how late every tick started
+		static const double jitter_buckets[RUNNER_JITTER_BUCKETS]; //upper limit of every bucket in seconds
+
+		LGraphRunner(LGraph* graph, double timestep = 0.01);
+
+		void start(); //resets the clock and the stats, called by the first tick
+		int tick(); //waits for the next deadline and runs the pending steps, returns how many
+		void resetStats();
+		void printStats(std::ostream& stream);
+
+	private:
+		bool started;
+		double accumulator;
+		clock::time_point last_time;
+		clock::time_point deadline;
+
+		void waitUntil(clock::time_point time);
+	};
+
+}
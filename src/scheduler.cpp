@@ -0,0 +1,127 @@
+#include "scheduler.h"
+
+#include <algorithm>
+
+LiteGraph::LGraphScheduler::LGraphScheduler(LThreadPool* pool)
+{
+	this->pool = pool;
+	max_steps_per_update = 8;
+	resetStats();
+}
+
+LiteGraph::LGraphScheduler::~LGraphScheduler()
+{
+	for (unsigned int i = 0; i < entries.size(); ++i)
+	{
+		delete entries[i]->graph;
+		delete entries[i];
+	}
+	entries.clear();
+}
+
+int LiteGraph::LGraphScheduler::add(LGraph* graph, double step_rate)
+{
+	Entry* entry = new Entry();
+	entry->graph = graph;
+	entry->step_rate = step_rate;
+	entry->accumulator = 0;
+	entry->worker = (int)entries.size() % pool->getNumThreads();
+	entry->steps = 0;
+	entry->num_latencies = 0;
+	entry->next_latency = 0;
+	entries.push_back(entry);
+	return (int)entries.size() - 1;
+}
+
+void LiteGraph::LGraphScheduler::runEntry(Entry* entry, int num_steps, double dt)
+{
+	for (int i = 0; i < num_steps; ++i)
+	{
+		auto start = std::chrono::steady_clock::now();
+		entry->graph->runStep((float)dt);
+		std::chrono::duration<float> latency = std::chrono::steady_clock::now() - start;
+
+		entry->latencies[entry->next_latency] = latency.count();
+		entry->next_latency = (entry->next_latency + 1) % SCHEDULER_LATENCY_SAMPLES;
+		if (entry->num_latencies < SCHEDULER_LATENCY_SAMPLES)
+			entry->num_latencies++;
+	}
+	entry->steps += num_steps;
+}
+
+void LiteGraph::LGraphScheduler::update(double elapsed)
+{
+	std::atomic<int> pending(0);
+	for (unsigned int i = 0; i < entries.size(); ++i)
+	{
+		Entry* entry = entries[i];
+		int num_steps = 1;
+		double dt = elapsed;
+		if (entry->step_rate > 0)
+		{
+			dt = 1.0 / entry->step_rate;
+			entry->accumulator += elapsed;
+			num_steps = (int)(entry->accumulator * entry->step_rate);
+			if (num_steps > max_steps_per_update)
+			{
+				num_steps = max_steps_per_update;
+				entry->accumulator = 0; //drop the time we cannot catch up
+			}
+			else
+				entry->accumulator -= num_steps * dt;
+		}
+		if (num_steps <= 0)
+			continue;
+
+		pending++;
+		pool->submit([this, entry, num_steps, dt, &pending]() {
+			runEntry(entry, num_steps, dt);
+			pending--;
+		}, entry->worker);
+	}
+	pool->waitFor(pending);
+}
+
+void LiteGraph::LGraphScheduler::resetStats()
+{
+	stats_start = std::chrono::steady_clock::now();
+	for (unsigned int i = 0; i < entries.size(); ++i)
+	{
+		entries[i]->steps = 0;
+		entries[i]->num_latencies = 0;
+		entries[i]->next_latency = 0;
+	}
+}
+
+unsigned long long LiteGraph::LGraphScheduler::getTotalSteps()
+{
+	unsigned long long total = 0;
+	for (unsigned int i = 0; i < entries.size(); ++i)
+		total += entries[i]->steps;
+	return total;
+}
+
+double LiteGraph::LGraphScheduler::getStepsPerSecond()
+{
+	std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - stats_start;
+	if (elapsed.count() <= 0)
+		return 0;
+	return getTotalSteps() / elapsed.count();
+}
+
+double LiteGraph::LGraphScheduler::getLatencyPercentile(int index, double percentile)
+{
+	if (index < 0 || index >= (int)entries.size())
+		return 0;
+	Entry* entry = entries[index];
+	if (!entry->num_latencies)
+		return 0;
+	if (!(percentile >= 0)) //also NaN
+		percentile = 0;
+	else if (percentile > 1)
+		percentile = 1;
+	std::vector<float> samples(entry->latencies, entry->latencies + entry->num_latencies);
+	int n = (int)(percentile * (samples.size() - 1) + 0.5);
+	std::nth_element(samples.begin(), samples.begin() + n, samples.end());
+	return samples[n];
+}
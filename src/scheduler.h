@@ -0,0 +1,54 @@
+#pragma once
+
+#include "litegraph.h"
+#include "threadpool.h"
+
+#include <chrono>
+
+#define SCHEDULER_LATENCY_SAMPLES 1024
+
+namespace LiteGraph {
+
+	//owns many graphs and steps each one at its own rate using a thread pool
+	//every graph is always sent to the same worker so its data stays in that core cache (unless an idle worker steals it)
+	class LGraphScheduler {
+	public:
+		struct Entry {
+			LGraph* graph;
+			double step_rate;		//steps per second, 0 to do one step per update
+			double accumulator;		//time not consumed by steps yet
+			int worker;
+
+			unsigned long long steps;
+			float latencies[SCHEDULER_LATENCY_SAMPLES];	//seconds of the last steps (ring buffer)
+			int num_latencies;
+			int next_latency;
+		};
+
+		LThreadPool* pool;			//not owned
+		int max_steps_per_update;	//to avoid a spiral when the machine cannot keep up
+
+		LGraphScheduler(LThreadPool* pool);
+		virtual ~LGraphScheduler();
+
+		int add(LGraph* graph, double step_rate); //takes ownership, returns the index
+		LGraph* getGraph(int index) { return entries[index]->graph; }
+		int getNumGraphs() { return (int)entries.size(); }
+
+		//advances all the graphs the elapsed seconds, blocks until all the steps are done
+		void update(double elapsed);
+
+		//stats
+		void resetStats();
+		unsigned long long getTotalSteps();
+		double getStepsPerSecond(); //since the last resetStats
+		double getLatencyPercentile(int index, double percentile); //in seconds, percentile in [0,1] p.e. 0.99, 0 if the index is not valid
+
+	private:
+		std::vector<Entry*> entries;
+		std::chrono::steady_clock::time_point stats_start;
+
+		void runEntry(Entry* entry, int num_steps, double dt);
+	};
+
+}
@@ -0,0 +1,144 @@
+#include "threadpool.h"
+
+LiteGraph::LThreadPool::LThreadPool(int num_threads)
+{
+	if (num_threads <= 0)
+		num_threads = (int)std::thread::hardware_concurrency();
+	if (num_threads <= 0)
+		num_threads = 1;
+
+	queued = 0;
+	next_worker = 0;
+	stopping = false;
+
+	for (int i = 0; i < num_threads; ++i)
+		workers.push_back(new Worker());
+	for (int i = 0; i < num_threads; ++i)
+		workers[i]->thread = std::thread(&LThreadPool::workerLoop, this, i);
+}
+
+LiteGraph::LThreadPool::~LThreadPool()
+{
+	{
+		std::lock_guard<std::mutex> lock(sleep_mutex);
+		stopping = true;
+	}
+	wake.notify_all();
+	for (unsigned int i = 0; i < workers.size(); ++i)
+	{
+		workers[i]->thread.join();
+		delete workers[i];
+	}
+	workers.clear();
+}
+
+void LiteGraph::LThreadPool::submit(const Task& task, int worker)
+{
+	if (worker < 0)
+		worker = next_worker++;
+	Worker* w = workers[worker % workers.size()];
+	{
+		std::lock_guard<std::mutex> lock(w->mutex);
+		w->tasks.push_back(task);
+	}
+	{
+		std::lock_guard<std::mutex> lock(sleep_mutex);
+		queued++;
+	}
+	wake.notify_one();
+}
+
+bool LiteGraph::LThreadPool::popTask(int worker, Task& task)
+{
+	int num = (int)workers.size();
+
+	//own queue, newest first (still hot in cache)
+	if (worker >= 0)
+	{
+		Worker* w = workers[worker];
+		std::lock_guard<std::mutex> lock(w->mutex);
+		if (!w->tasks.empty())
+		{
+			task = std::move(w->tasks.back());
+			w->tasks.pop_back();
+			queued--;
+			return true;
+		}
+	}
+
+	//steal the oldest from the others
+	int start = worker >= 0 ? worker + 1 : 0;
+	for (int i = 0; i < num; ++i)
+	{
+		Worker* w = workers[(start + i) % num];
+		std::lock_guard<std::mutex> lock(w->mutex);
+		if (w->tasks.empty())
+			continue;
+		task = std::move(w->tasks.front());
+		w->tasks.pop_front();
+		queued--;
+		return true;
+	}
+	return false;
+}
+
+void LiteGraph::LThreadPool::workerLoop(int worker)
+{
+	Task task;
+	while (true)
+	{
+		if (popTask(worker, task))
+		{
+			task();
+			continue;
+		}
+
+		std::unique_lock<std::mutex> lock(sleep_mutex);
+		wake.wait(lock, [this] { return stopping || queued > 0; });
+		if (stopping)
+			return;
+	}
+}
+
+void LiteGraph::LThreadPool::waitFor(std::atomic<int>& counter)
+{
+	Task task;
+	while (counter > 0)
+	{
+		if (popTask(-1, task))
+			task();
+		else
+			std::this_thread::yield();
+	}
+}
+
+void LiteGraph::LThreadPool::parallelFor(int count, int grain, const std::function<void(int start, int end)>& func)
+{
+	if (count <= 0)
+		return;
+	if (grain < 1)
+		grain = 1;
+
+	//a few chunks per thread so idle workers have something to steal
+	int chunk = count / ((int)workers.size() * 4);
+	if (chunk < grain)
+		chunk = grain;
+	int num_chunks = (count + chunk - 1) / chunk;
+	if (num_chunks == 1)
+	{
+		func(0, count);
+		return;
+	}
+
+	std::atomic<int> pending(num_chunks - 1);
+	for (int i = 1; i < num_chunks; ++i)
+	{
+		int start = i * chunk;
+		int end = start + chunk < count ? start + chunk : count;
+		submit([&func, &pending, start, end]() { func(start, end); pending--; }, i);
+	}
+
+	//first chunk in the calling thread
+	func(0, chunk);
+	waitFor(pending);
+}
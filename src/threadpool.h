@@ -0,0 +1,50 @@
+#pragma once
+
+#include <vector>
+#include <deque>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+
+namespace LiteGraph {
+
+	//fixed set of worker threads, every worker has its own queue and steals from the others when it runs out of work
+	class LThreadPool {
+	public:
+		typedef std::function<void()> Task;
+
+		LThreadPool(int num_threads = 0); //0 to use one thread per core
+		~LThreadPool();
+
+		int getNumThreads() { return (int)workers.size(); }
+
+		//worker is a hint to keep related tasks in the same thread (-1 round robin)
+		void submit(const Task& task, int worker = -1);
+
+		//splits [0,count) in chunks of at least grain elements, the calling thread helps until all are done
+		void parallelFor(int count, int grain, const std::function<void(int start, int end)>& func);
+
+		//executes queued tasks in the calling thread until counter reaches zero
+		void waitFor(std::atomic<int>& counter);
+
+	private:
+		struct Worker {
+			std::thread thread;
+			std::mutex mutex;
+			std::deque<Task> tasks;
+		};
+
+		std::vector<Worker*> workers;
+		std::atomic<int> queued;		//tasks waiting in any queue
+		std::atomic<unsigned int> next_worker;
+		std::atomic<bool> stopping;
+		std::mutex sleep_mutex;
+		std::condition_variable wake;
+
+		bool popTask(int worker, Task& task); //from its own queue or stolen from another one
+		void workerLoop(int worker);
+	};
+
+}
@@ -4,6 +4,7 @@
 #include <vector>
 
 #include "../../src/litegraph.h"
+#include "../../src/runner.h"
 
 //used only for sleep and keypress
 #include <windows.h>
@@ -32,11 +33,12 @@ int main()
 		exit(1);
 
 	std::cout << "Starting graph execution ****" << std::endl;
+	LiteGraph::LGraphRunner runner(&mygraph, 0.01);
 	while (1)
 	{
-		mygraph.runStep(0.01f);
-		Sleep(10);
+		runner.tick();
 		if ( (GetKeyState(' ') | GetKeyState(27)) & 0x8000 ) /*Check if high-order bit is set (1 << 15)*/
 			break;
 	}
+	runner.printStats(std::cout);
 }